@@ -0,0 +1,408 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_NO_POSIX_SIGNALS // the alternate signal stack of Catch 2.13.2 does not compile with glibc >= 2.34
+
+#include "catch.hpp"
+
+#include "../thread-pool/strand.hpp"
+#include "../thread-pool/thread_pool.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <latch>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+// thread per task - as launch_async() in futures/main.cpp
+template <typename Callable>
+auto launch_async(Callable&& callable)
+{
+    using ResultT = decltype(callable());
+    std::packaged_task<ResultT()> pt {std::forward<Callable>(callable)};
+    std::future<ResultT> f = pt.get_future();
+
+    std::thread thd {std::move(pt)};
+    thd.detach();
+
+    return f;
+}
+
+namespace Executors
+{
+    struct StdAsync
+    {
+    };
+
+    struct ThreadPerTask
+    {
+    };
+
+    // uniform "run callable, give me a future" over all executors under test
+    template <typename Callable>
+    auto spawn(ver_1_0::ThreadPool& pool, Callable callable)
+    {
+        using ResultT = decltype(callable());
+
+        auto pt = std::make_shared<std::packaged_task<ResultT()>>(std::move(callable));
+        std::future<ResultT> f = pt->get_future();
+        pool.submit([pt] { (*pt)(); });
+
+        return f;
+    }
+
+    template <typename Callable>
+    auto spawn(ver_1_1::ThreadPool& pool, Callable callable)
+    {
+        return pool.submit(std::move(callable));
+    }
+
+    template <typename Callable>
+    auto spawn(ver_2_0::ThreadPool& pool, Callable callable)
+    {
+        return pool.submit(std::move(callable));
+    }
+
+    template <typename Callable>
+    auto spawn(StdAsync&, Callable callable)
+    {
+        return std::async(std::launch::async, std::move(callable));
+    }
+
+    template <typename Callable>
+    auto spawn(ThreadPerTask&, Callable callable)
+    {
+        return launch_async(std::move(callable));
+    }
+
+    // a ver_2_0 worker waiting for a child runs queued tasks meanwhile; other executors block
+    template <typename Executor, typename Future>
+    auto join(Executor&, Future& f)
+    {
+        return f.get();
+    }
+
+    template <typename Future>
+    auto join(ver_2_0::ThreadPool& pool, Future& f)
+    {
+        return pool.get(f);
+    }
+}
+
+namespace Workloads
+{
+    // waits for a batch of empty tasks - cost of submission, queueing and completion signalling
+    template <typename Executor>
+    size_t empty_tasks(Executor& executor, size_t count)
+    {
+        vector<future<void>> futures;
+        futures.reserve(count);
+
+        for (size_t i = 0; i < count; ++i)
+            futures.push_back(Executors::spawn(executor, [] {}));
+
+        for (auto& f : futures)
+            f.get();
+
+        return futures.size();
+    }
+
+    // one task at a time - time from submit() until the task has started (and its result is back)
+    template <typename Executor>
+    auto round_trip(Executor& executor)
+    {
+        const auto submitted_at = chrono::steady_clock::now();
+        auto f = Executors::spawn(executor, [] { return chrono::steady_clock::now(); });
+        return f.get() - submitted_at;
+    }
+
+    uint64_t fib(uint64_t n)
+    {
+        return n < 2 ? n : fib(n - 1) + fib(n - 2);
+    }
+
+    // fork-join: every call above the cutoff forks one subproblem as a task
+    template <typename Executor>
+    uint64_t fork_join_fib(Executor& executor, uint64_t n, uint64_t cutoff)
+    {
+        if (n <= cutoff)
+            return fib(n);
+
+        auto left = Executors::spawn(executor, [&executor, n, cutoff] { return fork_join_fib(executor, n - 1, cutoff); });
+        const uint64_t right = fork_join_fib(executor, n - 2, cutoff);
+
+        return Executors::join(executor, left) + right;
+    }
+
+    uint64_t hits(size_t seed, uint64_t trials)
+    {
+        mt19937_64 rnd_gen {seed};
+        uniform_real_distribution<> distr(0, 1);
+
+        uint64_t counter {};
+        for (uint64_t n = 0; n < trials; ++n)
+        {
+            double x = distr(rnd_gen);
+            double y = distr(rnd_gen);
+            if (x * x + y * y < 1)
+                ++counter;
+        }
+
+        return counter;
+    }
+
+    template <typename Executor>
+    double monte_carlo_pi(Executor& executor, uint64_t total_trials, size_t task_count)
+    {
+        const uint64_t trials_per_task = total_trials / task_count;
+
+        vector<future<uint64_t>> futures;
+        for (size_t i = 0; i < task_count; ++i)
+            futures.push_back(Executors::spawn(executor, [i, trials_per_task] { return hits(i, trials_per_task); }));
+
+        uint64_t total_hits {};
+        for (auto& f : futures)
+            total_hits += f.get();
+
+        return static_cast<double>(total_hits) / (trials_per_task * task_count) * 4;
+    }
+
+    uint64_t busy_work(uint64_t units)
+    {
+        uint64_t x = units;
+        for (uint64_t i = 0; i < units * 64; ++i)
+            x = x * 6364136223846793005ULL + 1442695040888963407ULL;
+        return x;
+    }
+
+    // the same amount of work split into task_count tasks
+    template <typename Executor>
+    uint64_t work_mix(Executor& executor, uint64_t total_units, size_t task_count)
+    {
+        vector<future<uint64_t>> futures;
+        for (size_t i = 0; i < task_count; ++i)
+            futures.push_back(Executors::spawn(executor, [units = total_units / task_count] { return busy_work(units); }));
+
+        uint64_t checksum {};
+        for (auto& f : futures)
+            checksum ^= f.get();
+
+        return checksum;
+    }
+
+    // ver_2_0 only below - features the other executors do not have
+
+    // one submit_bulk() batch of count empty items - compare with empty_tasks()
+    size_t bulk_tasks(ver_2_0::ThreadPool& pool, size_t count)
+    {
+        vector<size_t> items(count);
+        pool.submit_bulk(items.begin(), items.end(), [](size_t) {}).wait();
+        return items.size();
+    }
+
+    // fire-and-forget tasks - no packaged_task and no future per task
+    size_t posted_tasks(ver_2_0::ThreadPool& pool, size_t count)
+    {
+        latch done {static_cast<ptrdiff_t>(count)};
+        for (size_t i = 0; i < count; ++i)
+            pool.post([&done] { done.count_down(); });
+        done.wait();
+
+        return count;
+    }
+
+    // tasks serialized by a strand - no mutex around the counter
+    size_t strand_tasks(ver_2_0::Strand& strand, size_t count)
+    {
+        size_t counter = 0;
+        for (size_t i = 0; i < count; ++i)
+            strand.post([&counter] { ++counter; });
+
+        return strand.submit([&counter] { return counter; }).get();
+    }
+
+    // all three priorities, every other task with a deadline - cost of ordering the queue
+    uint64_t prioritized_tasks(ver_2_0::ThreadPool& pool, size_t count)
+    {
+        vector<future<uint64_t>> futures;
+        futures.reserve(count);
+
+        const auto deadline = ver_2_0::Clock::now() + chrono::milliseconds {1};
+        for (size_t i = 0; i < count; ++i)
+        {
+            ver_2_0::TaskOptions options;
+            options.priority = static_cast<ver_2_0::TaskPriority>(i % 3);
+            if (i % 2 == 0)
+                options.deadline = deadline;
+
+            futures.push_back(pool.submit(options, [] { return busy_work(16); }));
+        }
+
+        uint64_t checksum {};
+        for (auto& f : futures)
+            checksum ^= f.get();
+
+        return checksum;
+    }
+
+    // a burst larger than the queue bound - cost of the overflow policy; returns the number of tasks that ran
+    size_t overflow_burst(ver_2_0::ThreadPool& pool, size_t count)
+    {
+        vector<future<uint64_t>> futures;
+        futures.reserve(count);
+
+        for (size_t i = 0; i < count; ++i)
+        {
+            try
+            {
+                futures.push_back(pool.submit([] { return busy_work(16); }));
+            }
+            catch (const ver_2_0::TaskRejected&)
+            {
+            }
+        }
+
+        size_t completed = 0;
+        for (auto& f : futures)
+        {
+            try
+            {
+                f.get();
+                ++completed;
+            }
+            catch (const future_error&) // dropped by drop_oldest
+            {
+            }
+        }
+
+        return completed;
+    }
+}
+
+namespace
+{
+    const size_t thread_count = max(1u, thread::hardware_concurrency());
+
+    ver_2_0::ThreadPoolOptions elastic_options()
+    {
+        ver_2_0::ThreadPoolOptions options {1, thread_count};
+        options.spawn_threshold = chrono::milliseconds {1};
+        return options;
+    }
+
+    ver_2_0::ThreadPoolOptions compact_options()
+    {
+        ver_2_0::ThreadPoolOptions options {thread_count, thread_count};
+        options.placement = ver_2_0::WorkerPlacement::compact;
+        return options;
+    }
+
+    ver_2_0::ThreadPoolOptions bounded_options(ver_2_0::OverflowPolicy overflow)
+    {
+        ver_2_0::ThreadPoolOptions options {thread_count, thread_count};
+        options.max_queued = 64;
+        options.overflow = overflow;
+        return options;
+    }
+}
+
+// runs the benchmark body for every executor; ver_1_x pools are skipped by workloads that would deadlock them
+#define BENCHMARK_ALL_EXECUTORS(name, body, with_ver_1)                                   \
+    {                                                                                     \
+        if (with_ver_1)                                                                   \
+        {                                                                                 \
+            ver_1_0::ThreadPool pool_1_0 {thread_count};                                  \
+            BENCHMARK(name " - ver_1_0") { auto& executor = pool_1_0; return body; };     \
+            ver_1_1::ThreadPool pool_1_1 {thread_count};                                  \
+            BENCHMARK(name " - ver_1_1") { auto& executor = pool_1_1; return body; };     \
+        }                                                                                 \
+        ver_2_0::ThreadPool pool_2_0 {thread_count};                                      \
+        BENCHMARK(name " - ver_2_0") { auto& executor = pool_2_0; return body; };         \
+        ver_2_0::ThreadPool pool_elastic {elastic_options()};                             \
+        BENCHMARK(name " - ver_2_0 elastic") { auto& executor = pool_elastic; return body; }; \
+        ver_2_0::ThreadPool pool_compact {compact_options()};                             \
+        BENCHMARK(name " - ver_2_0 compact") { auto& executor = pool_compact; return body; }; \
+        Executors::StdAsync std_async;                                                    \
+        BENCHMARK(name " - std::async") { auto& executor = std_async; return body; };     \
+        Executors::ThreadPerTask thread_per_task;                                         \
+        BENCHMARK(name " - launch_async") { auto& executor = thread_per_task; return body; }; \
+    }
+
+TEST_CASE("Empty tasks - submit throughput")
+{
+    BENCHMARK_ALL_EXECUTORS("1000 empty tasks", Workloads::empty_tasks(executor, 1000), true);
+}
+
+TEST_CASE("Submit-to-start latency")
+{
+    BENCHMARK_ALL_EXECUTORS("round trip", Workloads::round_trip(executor), true);
+}
+
+TEST_CASE("Fork-join fib(30)")
+{
+    // a ver_1_x worker blocked on a child that waits in the queue behind it deadlocks the pool
+    BENCHMARK_ALL_EXECUTORS("fib(30), cutoff 20", Workloads::fork_join_fib(executor, 30, 20), false);
+}
+
+TEST_CASE("Monte Carlo Pi")
+{
+    const uint64_t N = 4'000'000;
+
+    BENCHMARK_ALL_EXECUTORS("pi - task per thread", Workloads::monte_carlo_pi(executor, N, thread_count), true);
+    BENCHMARK_ALL_EXECUTORS("pi - 64 tasks", Workloads::monte_carlo_pi(executor, N, 64), true);
+}
+
+TEST_CASE("Task granularity - many small vs few large")
+{
+    const uint64_t units = 1 << 16;
+
+    BENCHMARK_ALL_EXECUTORS("few large tasks", Workloads::work_mix(executor, units, thread_count), true);
+    BENCHMARK_ALL_EXECUTORS("many small tasks", Workloads::work_mix(executor, units, 4096), true);
+}
+
+TEST_CASE("Submission APIs - ver_2_0")
+{
+    const size_t count = 1000;
+
+    ver_2_0::ThreadPool pool {thread_count};
+    ver_2_0::Strand strand {pool};
+
+    BENCHMARK("1000 empty tasks - submit") { return Workloads::empty_tasks(pool, count); };
+    BENCHMARK("1000 empty tasks - submit_bulk") { return Workloads::bulk_tasks(pool, count); };
+    BENCHMARK("1000 empty tasks - post") { return Workloads::posted_tasks(pool, count); };
+    BENCHMARK("1000 tasks - strand") { return Workloads::strand_tasks(strand, count); };
+}
+
+TEST_CASE("Priorities and deadlines - ver_2_0")
+{
+    ver_2_0::ThreadPool pool {thread_count};
+
+    BENCHMARK("1000 tasks - default priority") { return Workloads::work_mix(pool, 1000 * 16, 1000); };
+    BENCHMARK("1000 tasks - mixed priorities and deadlines") { return Workloads::prioritized_tasks(pool, 1000); };
+}
+
+TEST_CASE("Admission control - ver_2_0")
+{
+    const size_t count = 1000;
+
+    ver_2_0::ThreadPool unbounded {thread_count};
+    BENCHMARK("burst of 1000 - unbounded") { return Workloads::overflow_burst(unbounded, count); };
+
+    ver_2_0::ThreadPool block {bounded_options(ver_2_0::OverflowPolicy::block)};
+    BENCHMARK("burst of 1000, bound 64 - block") { return Workloads::overflow_burst(block, count); };
+
+    ver_2_0::ThreadPool reject {bounded_options(ver_2_0::OverflowPolicy::reject)};
+    BENCHMARK("burst of 1000, bound 64 - reject") { return Workloads::overflow_burst(reject, count); };
+
+    ver_2_0::ThreadPool caller_runs {bounded_options(ver_2_0::OverflowPolicy::caller_runs)};
+    BENCHMARK("burst of 1000, bound 64 - caller_runs") { return Workloads::overflow_burst(caller_runs, count); };
+
+    ver_2_0::ThreadPool drop_oldest {bounded_options(ver_2_0::OverflowPolicy::drop_oldest)};
+    BENCHMARK("burst of 1000, bound 64 - drop_oldest") { return Workloads::overflow_burst(drop_oldest, count); };
+}
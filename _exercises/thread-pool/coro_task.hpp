@@ -0,0 +1,235 @@
+#ifndef CORO_TASK_HPP
+#define CORO_TASK_HPP
+
+#include "thread_pool.hpp"
+
+#include <coroutine>
+#include <exception>
+#include <future>
+#include <optional>
+#include <utility>
+
+namespace ver_2_0
+{
+    namespace detail
+    {
+        struct CoroPromiseBase
+        {
+            struct FinalAwaiter
+            {
+                bool await_ready() const noexcept
+                {
+                    return false;
+                }
+
+                // symmetric transfer to the awaiting coroutine - long chains of co_await do not grow the stack
+                template <typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+                {
+                    return handle.promise().continuation;
+                }
+
+                void await_resume() const noexcept
+                {
+                }
+            };
+
+            std::suspend_always initial_suspend() const noexcept
+            {
+                return {};
+            }
+
+            FinalAwaiter final_suspend() const noexcept
+            {
+                return {};
+            }
+
+            void unhandled_exception() noexcept
+            {
+                eptr = std::current_exception();
+            }
+
+            std::coroutine_handle<> continuation = std::noop_coroutine();
+            std::exception_ptr eptr;
+        };
+
+        template <typename T>
+        struct CoroPromise : CoroPromiseBase
+        {
+            template <typename U>
+            void return_value(U&& value)
+            {
+                result_.emplace(std::forward<U>(value));
+            }
+
+            T result()
+            {
+                if (eptr)
+                    std::rethrow_exception(eptr);
+                return std::move(*result_);
+            }
+
+        private:
+            std::optional<T> result_;
+        };
+
+        template <>
+        struct CoroPromise<void> : CoroPromiseBase
+        {
+            void return_void() const noexcept
+            {
+            }
+
+            void result()
+            {
+                if (eptr)
+                    std::rethrow_exception(eptr);
+            }
+        };
+    }
+
+    // lazily started coroutine - it runs when awaited, on the thread of the awaiting coroutine
+    template <typename T = void>
+    class [[nodiscard]] CoroTask
+    {
+    public:
+        struct promise_type : detail::CoroPromise<T>
+        {
+            CoroTask get_return_object() noexcept
+            {
+                return CoroTask {std::coroutine_handle<promise_type>::from_promise(*this)};
+            }
+        };
+
+        CoroTask(const CoroTask&) = delete;
+        CoroTask& operator=(const CoroTask&) = delete;
+
+        CoroTask(CoroTask&& other) noexcept
+            : handle_ {std::exchange(other.handle_, nullptr)}
+        {
+        }
+
+        CoroTask& operator=(CoroTask&& other) noexcept
+        {
+            if (this != &other)
+            {
+                if (handle_)
+                    handle_.destroy();
+                handle_ = std::exchange(other.handle_, nullptr);
+            }
+
+            return *this;
+        }
+
+        ~CoroTask()
+        {
+            if (handle_)
+                handle_.destroy();
+        }
+
+        auto operator co_await() noexcept
+        {
+            struct Awaiter
+            {
+                std::coroutine_handle<promise_type> handle;
+
+                bool await_ready() const noexcept
+                {
+                    return handle.done();
+                }
+
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+                {
+                    handle.promise().continuation = awaiting;
+                    return handle;
+                }
+
+                T await_resume()
+                {
+                    return handle.promise().result();
+                }
+            };
+
+            return Awaiter {handle_};
+        }
+
+    private:
+        explicit CoroTask(std::coroutine_handle<promise_type> handle)
+            : handle_ {handle}
+        {
+        }
+
+        std::coroutine_handle<promise_type> handle_;
+    };
+
+    namespace detail
+    {
+        // eagerly started coroutine that destroys its frame when it finishes
+        struct DetachedCoroutine
+        {
+            struct promise_type
+            {
+                DetachedCoroutine get_return_object() const noexcept
+                {
+                    return {};
+                }
+
+                std::suspend_never initial_suspend() const noexcept
+                {
+                    return {};
+                }
+
+                std::suspend_never final_suspend() const noexcept
+                {
+                    return {};
+                }
+
+                void return_void() const noexcept
+                {
+                }
+
+                void unhandled_exception() const noexcept
+                {
+                    std::terminate();
+                }
+            };
+        };
+
+        template <typename T>
+        DetachedCoroutine run_detached(ThreadPool& pool, CoroTask<T> task, std::promise<T> promise)
+        {
+            try
+            {
+                co_await pool.schedule_admitted(); // throws TaskRejected if the pool refuses to start the coroutine
+
+                if constexpr (std::is_void_v<T>)
+                {
+                    co_await task;
+                    promise.set_value();
+                }
+                else
+                    promise.set_value(co_await task);
+            }
+            catch (...)
+            {
+                promise.set_exception(std::current_exception());
+            }
+        }
+    }
+
+    // starts the coroutine on a worker of the pool; the future gets its result - or TaskRejected when spawned
+    // from outside of the pool into a full queue with the reject policy; the start is admitted as submit() is,
+    // later resumptions inside the coroutine are not
+    template <typename T>
+    std::future<T> spawn(ThreadPool& pool, CoroTask<T> task)
+    {
+        std::promise<T> promise;
+        std::future<T> result = promise.get_future();
+
+        detail::run_detached(pool, std::move(task), std::move(promise));
+
+        return result;
+    }
+}
+
+#endif // CORO_TASK_HPP
@@ -0,0 +1,247 @@
+#ifndef CPU_TOPOLOGY_HPP
+#define CPU_TOPOLOGY_HPP
+
+#include <algorithm>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+class CpuTopology
+{
+public:
+    struct Cpu
+    {
+        int id;
+        int package;
+        int core; // lowest cpu id among the SMT siblings
+        int l2;   // lowest cpu id sharing the L2 cache
+        int l3;   // lowest cpu id sharing the L3 cache
+    };
+
+    explicit CpuTopology(std::vector<Cpu> cpus)
+        : cpus_ {std::move(cpus)}
+    {
+        std::sort(cpus_.begin(), cpus_.end(), [](const Cpu& a, const Cpu& b) { return a.id < b.id; });
+    }
+
+    // reads the topology of cpus this process is allowed to run on
+    static CpuTopology detect(const std::string& sysfs_root = "/sys/devices/system/cpu")
+    {
+        std::vector<Cpu> cpus;
+
+        for (int id : parse_cpu_list(read_line(sysfs_root + "/online")))
+        {
+            if (!is_allowed(id))
+                continue;
+
+            const std::string cpu_dir = sysfs_root + "/cpu" + std::to_string(id);
+
+            Cpu cpu {id, read_int(cpu_dir + "/topology/physical_package_id", 0), id, id, -1};
+            cpu.core = lowest(read_line(cpu_dir + "/topology/thread_siblings_list"), id);
+            cpu.l2 = cpu.core;
+
+            for (int index = 0;; ++index)
+            {
+                const std::string cache_dir = cpu_dir + "/cache/index" + std::to_string(index);
+                const int level = read_int(cache_dir + "/level", -1);
+                if (level < 0)
+                    break;
+
+                if (level == 2)
+                    cpu.l2 = lowest(read_line(cache_dir + "/shared_cpu_list"), cpu.l2);
+                else if (level == 3)
+                    cpu.l3 = lowest(read_line(cache_dir + "/shared_cpu_list"), cpu.l3);
+            }
+
+            if (cpu.l3 < 0) // no L3 - treat the whole package as one domain
+                cpu.l3 = -1 - cpu.package;
+
+            cpus.push_back(cpu);
+        }
+
+        if (cpus.empty()) // sysfs is not available - flat topology
+        {
+            const int count = std::max(1u, std::thread::hardware_concurrency());
+            for (int id = 0; id < count; ++id)
+                cpus.push_back(Cpu {id, 0, id, id, 0});
+        }
+
+        return CpuTopology {std::move(cpus)};
+    }
+
+    const std::vector<Cpu>& cpus() const
+    {
+        return cpus_;
+    }
+
+    bool contains(int cpu) const
+    {
+        return find(cpu) != nullptr;
+    }
+
+    // SMT siblings first, then cores sharing a cache, then packages
+    std::vector<int> compact_order() const
+    {
+        std::vector<Cpu> sorted = cpus_;
+        std::sort(sorted.begin(), sorted.end(), [](const Cpu& a, const Cpu& b) {
+            return std::tie(a.package, a.l3, a.l2, a.core, a.id) < std::tie(b.package, b.l3, b.l2, b.core, b.id);
+        });
+
+        return ids(sorted);
+    }
+
+    // one cpu per package, then per L3 domain, then per core - SMT siblings are used last
+    std::vector<int> scatter_order() const
+    {
+        const auto smt_rank = rank_within(&Cpu::core, &Cpu::id);
+        const auto core_rank = rank_within(&Cpu::l3, &Cpu::core);
+        const auto l3_rank = rank_within(&Cpu::package, &Cpu::l3);
+
+        std::vector<std::tuple<int, int, int, int, int>> keys;
+        for (const auto& cpu : cpus_)
+            keys.emplace_back(smt_rank.at(cpu.id), core_rank.at(cpu.id), l3_rank.at(cpu.id), cpu.package, cpu.id);
+        std::sort(keys.begin(), keys.end());
+
+        std::vector<int> order;
+        for (const auto& key : keys)
+            order.push_back(std::get<4>(key));
+
+        return order;
+    }
+
+    // 0 - same core, 1 - shared L2, 2 - shared L3, 3 - same package, 4 - other package or unknown cpu
+    int distance(int cpu_a, int cpu_b) const
+    {
+        const Cpu* a = find(cpu_a);
+        const Cpu* b = find(cpu_b);
+
+        if (!a || !b)
+            return 4;
+        if (a->core == b->core)
+            return 0;
+        if (a->l2 == b->l2)
+            return 1;
+        if (a->l3 == b->l3)
+            return 2;
+        if (a->package == b->package)
+            return 3;
+        return 4;
+    }
+
+    // "0-3,8,10-11" -> {0, 1, 2, 3, 8, 10, 11}
+    static std::vector<int> parse_cpu_list(const std::string& text)
+    {
+        std::vector<int> cpus;
+        std::istringstream in {text};
+        std::string range;
+
+        while (std::getline(in, range, ','))
+        {
+            if (range.empty())
+                continue;
+
+            const auto dash = range.find('-');
+            const int first = std::stoi(range.substr(0, dash));
+            const int last = (dash == std::string::npos) ? first : std::stoi(range.substr(dash + 1));
+
+            for (int id = first; id <= last; ++id)
+                cpus.push_back(id);
+        }
+
+        return cpus;
+    }
+
+private:
+    std::vector<Cpu> cpus_;
+
+    const Cpu* find(int cpu) const
+    {
+        auto it = std::find_if(cpus_.begin(), cpus_.end(), [cpu](const Cpu& c) { return c.id == cpu; });
+        return (it == cpus_.end()) ? nullptr : &*it;
+    }
+
+    static std::vector<int> ids(const std::vector<Cpu>& cpus)
+    {
+        std::vector<int> result;
+        for (const auto& cpu : cpus)
+            result.push_back(cpu.id);
+        return result;
+    }
+
+    // for every cpu: index of its 'member' value among distinct values within the same 'group'
+    std::map<int, int> rank_within(int Cpu::*group, int Cpu::*member) const
+    {
+        std::map<int, std::vector<int>> members;
+        for (const auto& cpu : cpus_)
+        {
+            auto& values = members[cpu.*group];
+            if (std::find(values.begin(), values.end(), cpu.*member) == values.end())
+                values.push_back(cpu.*member);
+        }
+
+        std::map<int, int> rank;
+        for (const auto& cpu : cpus_)
+        {
+            auto& values = members[cpu.*group];
+            std::sort(values.begin(), values.end());
+            rank[cpu.id] = static_cast<int>(std::find(values.begin(), values.end(), cpu.*member) - values.begin());
+        }
+
+        return rank;
+    }
+
+    static std::string read_line(const std::string& path)
+    {
+        std::ifstream in {path};
+        std::string line;
+        std::getline(in, line);
+        return line;
+    }
+
+    static int read_int(const std::string& path, int default_value)
+    {
+        const std::string line = read_line(path);
+        return line.empty() ? default_value : std::stoi(line);
+    }
+
+    static int lowest(const std::string& cpu_list, int default_value)
+    {
+        const auto cpus = parse_cpu_list(cpu_list);
+        return cpus.empty() ? default_value : *std::min_element(cpus.begin(), cpus.end());
+    }
+
+    static bool is_allowed(int cpu)
+    {
+#ifdef __linux__
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        if (sched_getaffinity(0, sizeof(set), &set) == 0)
+            return CPU_ISSET(cpu, &set);
+#endif
+        return true;
+    }
+};
+
+// binds a thread to a single cpu; returns false if the platform does not support it
+inline bool pin_thread(std::thread& thd, int cpu)
+{
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    return pthread_setaffinity_np(thd.native_handle(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+#endif // CPU_TOPOLOGY_HPP
@@ -0,0 +1,46 @@
+#ifndef EXECUTORS_HPP
+#define EXECUTORS_HPP
+
+#include "thread_pool.hpp"
+
+#include <chrono>
+#include <thread>
+
+namespace ver_2_0
+{
+    struct ExecutorsOptions
+    {
+        // CPU-bound work - one worker per hardware thread
+        ThreadPoolOptions compute {std::max(1u, std::thread::hardware_concurrency()), std::max(1u, std::thread::hardware_concurrency())};
+
+        // blocking I/O - a worker is started whenever no idle one is left, idle workers retire quickly
+        ThreadPoolOptions blocking {0, 64, std::chrono::milliseconds {0}, std::chrono::milliseconds {1'000}, 0};
+    };
+
+    // separate pools for compute and blocking tasks, so tasks waiting for I/O do not starve CPU-bound work
+    class Executors
+    {
+    public:
+        explicit Executors(const ExecutorsOptions& options = {})
+            : compute_ {options.compute}
+            , blocking_ {options.blocking}
+        {
+        }
+
+        ThreadPool& compute()
+        {
+            return compute_;
+        }
+
+        ThreadPool& blocking()
+        {
+            return blocking_;
+        }
+
+    private:
+        ThreadPool compute_;
+        ThreadPool blocking_;
+    };
+}
+
+#endif // EXECUTORS_HPP
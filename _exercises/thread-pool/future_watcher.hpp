@@ -0,0 +1,116 @@
+#ifndef FUTURE_WATCHER_HPP
+#define FUTURE_WATCHER_HPP
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <iterator>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ver_2_0
+{
+    // resumes work waiting for futures that have no completion callback (std::future, std::shared_future):
+    // one thread polls the watched futures without blocking on any of them and hands the continuation of a ready
+    // one to dispatch, so no pool worker is held while the future is pending; the poll interval starts short
+    // and backs off while nothing becomes ready
+    class FutureWatcher
+    {
+    public:
+        using Dispatch = std::function<void(std::function<void()>)>;
+
+        static constexpr std::chrono::microseconds min_interval {20};
+        static constexpr std::chrono::microseconds max_interval {1000};
+
+        explicit FutureWatcher(Dispatch dispatch)
+            : dispatch_ {std::move(dispatch)}
+            , thd_ {&FutureWatcher::run, this}
+        {
+        }
+
+        FutureWatcher(const FutureWatcher&) = delete;
+        FutureWatcher& operator=(const FutureWatcher&) = delete;
+
+        // pending continuations are dropped without running
+        ~FutureWatcher()
+        {
+            {
+                std::lock_guard lk {mtx_};
+                stop_ = true;
+            }
+            cv_.notify_one();
+            thd_.join();
+        }
+
+        // ready is polled on the watcher thread; continuation is dispatched once, after ready returned true
+        void watch(std::function<bool()> ready, std::function<void()> continuation)
+        {
+            {
+                std::lock_guard lk {mtx_};
+                watched_.push_back(Watched {std::move(ready), std::move(continuation)});
+                added_ = true;
+            }
+            cv_.notify_one();
+        }
+
+    private:
+        struct Watched
+        {
+            std::function<bool()> ready;
+            std::function<void()> continuation;
+        };
+
+        void run()
+        {
+            std::unique_lock lk {mtx_};
+            std::chrono::microseconds interval = min_interval;
+
+            while (!stop_)
+            {
+                if (watched_.empty())
+                {
+                    cv_.wait(lk, [this] { return stop_ || !watched_.empty(); });
+                    interval = min_interval;
+                    continue;
+                }
+
+                std::vector<Watched> polled = std::exchange(watched_, {});
+                added_ = false;
+                lk.unlock();
+
+                bool any_ready = false;
+                std::vector<Watched> waiting;
+                for (Watched& watched : polled)
+                {
+                    if (watched.ready())
+                    {
+                        dispatch_(std::move(watched.continuation));
+                        any_ready = true;
+                    }
+                    else
+                        waiting.push_back(std::move(watched));
+                }
+
+                lk.lock();
+                std::move(waiting.begin(), waiting.end(), std::back_inserter(watched_));
+
+                interval = any_ready ? min_interval : std::min(interval * 2, max_interval);
+                if (cv_.wait_for(lk, interval, [this] { return stop_ || added_; }))
+                    interval = min_interval; // a new future is often ready soon
+            }
+        }
+
+        Dispatch dispatch_;
+        std::mutex mtx_;
+        std::condition_variable cv_;
+        std::vector<Watched> watched_;
+        bool added_ = false;
+        bool stop_ = false;
+        std::thread thd_; // started last
+    };
+}
+
+#endif // FUTURE_WATCHER_HPP
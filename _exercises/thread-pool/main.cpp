@@ -1,7 +1,11 @@
-#include "thread_safe_queue.hpp"
+#include "coro_task.hpp"
+#include "executors.hpp"
+#include "strand.hpp"
+#include "thread_pool.hpp"
 
 #include <cassert>
 #include <chrono>
+#include <fstream>
 #include <functional>
 #include <future>
 #include <iostream>
@@ -12,136 +16,6 @@
 
 using namespace std::literals;
 
-using Task = std::function<void()>;
-
-namespace ver_1_0
-{
-    class ThreadPool
-    {
-    public:
-        static inline Task poisoning_pill {};
-
-        explicit ThreadPool(size_t size)
-            : threads_(size)
-        {
-            for (auto& thd : threads_)
-            {
-                // thd = std::thread{[this]{ run();}};
-                thd = std::thread {&ThreadPool::run, this};
-            }
-        }
-
-        ThreadPool(const ThreadPool&) = delete;
-        ThreadPool& operator=(const ThreadPool&) = delete;
-
-        ~ThreadPool()
-        {
-            for (size_t i = 0; i < threads_.size(); ++i)
-                send_poisoning_pill();
-
-            for (auto& thd : threads_)
-                if (thd.joinable())
-                    thd.join();
-        }
-
-        void submit(const Task& task)
-        {
-            if (is_poisoning_pill(task))
-                throw std::invalid_argument("Empty function is not supported");
-
-            q_tasks_.push(task);
-        }
-
-    private:
-        void send_poisoning_pill()
-        {
-            q_tasks_.push(poisoning_pill);
-        }
-
-        bool is_poisoning_pill(const Task& task) const
-        {
-            return task == nullptr;
-        }
-
-        void run()
-        {
-            Task task;
-            while (true)
-            {
-                q_tasks_.pop(task);
-                if (is_poisoning_pill(task))
-                    return;
-                task();
-            };
-        }
-
-        ThreadSafeQueue<Task> q_tasks_;
-        std::vector<std::thread> threads_;
-    };
-}
-
-namespace ver_1_1
-{
-    class ThreadPool
-    {
-    public:
-        explicit ThreadPool(size_t size)
-            : threads_(size)
-        {
-            for (auto& thd : threads_)
-            {
-                // thd = std::thread{[this]{ run();}};
-                thd = std::thread {&ThreadPool::run, this};
-            }
-        }
-
-        ThreadPool(const ThreadPool&) = delete;
-        ThreadPool& operator=(const ThreadPool&) = delete;
-
-        ~ThreadPool()
-        {
-            for (size_t i = 0; i < threads_.size(); ++i)
-                submit([this] { end_work_ = true; });
-
-            for (auto& thd : threads_)
-                if (thd.joinable())
-                    thd.join();
-        }
-
-        template <typename Callable>
-        auto submit(Callable&& callable) -> std::future<decltype(callable())>
-        {
-            using ResultT = decltype(callable());
-
-            auto pt = std::make_shared<std::packaged_task<ResultT()>>(std::forward<Callable>(callable));
-            std::future<ResultT> fresult = pt->get_future();
-            
-            q_tasks_.push([pt] { (*pt)(); });
-
-            return fresult;
-        }
-
-    private:
-        void run()
-        {
-            Task task;
-            while (true)
-            {
-                q_tasks_.pop(task);
-                
-                task();
-                
-                if (end_work_)
-                    return;
-            };
-        }
-
-        ThreadSafeQueue<Task> q_tasks_;
-        std::vector<std::thread> threads_;
-        std::atomic<bool> end_work_{false};
-    };
-}
-
 void background_work(size_t id, const std::string& text, std::chrono::milliseconds delay)
 {
     std::cout << "bw#" << id << " has started in the thread#" << std::this_thread::get_id() << std::endl;
@@ -171,27 +45,140 @@ int calculate_square(int x)
     return x * x;
 }
 
+void save_to_file(const std::string& filename)
+{
+    std::cout << "Saving to file: " << filename << " in thread#" << std::this_thread::get_id() << std::endl;
+
+    std::this_thread::sleep_for(300ms);
+
+    std::cout << "File saved: " << filename << std::endl;
+}
+
+ver_2_0::CoroTask<int> square_on_pool(ver_2_0::ThreadPool& pool, int x)
+{
+    co_await pool.schedule(); // continues on a worker of the pool
+
+    co_return calculate_square(x);
+}
+
+ver_2_0::CoroTask<int> sum_of_squares(ver_2_0::ThreadPool& pool)
+{
+    const int a = co_await square_on_pool(pool, 2);
+    const int b = co_await pool.when_ready(pool.submit([] { return calculate_square(10); }));
+
+    co_return a + b;
+}
+
 int main()
 {
     std::cout << "Main thread starts..." << std::endl;
     const std::string text = "Hello Threads";
 
-    ver_1_1::ThreadPool thread_pool(6);
+    ver_2_0::ThreadPool thread_pool(6);
+
+    ver_2_0::TimerHandle heartbeat = thread_pool.schedule_every(500ms, []
+        { std::cout << "heartbeat in thread#" << std::this_thread::get_id() << std::endl; });
+    thread_pool.schedule_after(1s, []
+        { std::cout << "delayed task in thread#" << std::this_thread::get_id() << std::endl; });
 
     thread_pool.submit([&]
         { background_work(1, text, 20ms); });
     thread_pool.submit([&]
         { background_work(2, "thread pool", 30ms); });
     thread_pool.submit([&]
-        { background_work(3, "thread pool", 30ms); });
+        {
+            ver_2_0::BlockingSection blocking; // sleeps most of the time - let the pool compensate
+            background_work(3, "thread pool", 30ms);
+        });
 
 
     std::future<int> fs19 = thread_pool.submit([] { return calculate_square(19); });
     std::future<int> fs31 = thread_pool.submit([] { return calculate_square(31); });
 
 
+    std::future<int> fs7 = thread_pool.submit(
+        ver_2_0::TaskOptions{ver_2_0::TaskPriority::high, ver_2_0::Clock::now() + 100ms, "square(7)"},
+        [] { return calculate_square(7); });
+
+    std::future<int> fsum = thread_pool.submit([&thread_pool] {
+        std::future<int> fb = thread_pool.submit( // prefers the parent's worker - the one waiting for it below
+            ver_2_0::TaskOptions{ver_2_0::TaskPriority::normal, std::nullopt, "square(5)", ver_2_0::TaskAffinity::same_worker},
+            [] { return calculate_square(5); });
+        std::future<int> fa = thread_pool.submit([] { return calculate_square(4); }); // taken by an idle worker
+
+        // runs queued tasks instead of blocking the worker - fb first, as the oldest; had fa come first,
+        // the parent would be busy with it and fb would be stolen once it waited for affinity_max_wait
+        const int b = thread_pool.get(fb);
+        return thread_pool.get(fa) + b;
+    });
+
     std::cout << "19 * 19 = " << fs19.get() << std::endl;
     std::cout << "31 * 31 = " << fs31.get() << std::endl;
+    std::cout << "7 * 7 = " << fs7.get() << std::endl;
+    std::cout << "4 * 4 + 5 * 5 = " << fsum.get() << std::endl;
+
+    std::cout << "2 * 2 + 10 * 10 = " << ver_2_0::spawn(thread_pool, sum_of_squares(thread_pool)).get() << std::endl;
+
+    heartbeat.cancel();
+
+    std::stop_source abandon_request;
+    std::future<int> fslow = thread_pool.submit(abandon_request.get_token(), [](std::stop_token st) {
+        int steps = 0;
+        for (; steps < 100 && !st.stop_requested(); ++steps)
+            std::this_thread::sleep_for(10ms);
+        return steps;
+    });
+    std::this_thread::sleep_for(50ms);
+    abandon_request.request_stop();
+
+    try
+    {
+        const int steps = fslow.get();
+        std::cout << "Slow request: " << steps << " steps" << std::endl;
+    }
+    catch (const ver_2_0::TaskCancelled& e)
+    {
+        std::cout << "Slow request: " << e.what() << std::endl;
+    }
+
+    ver_2_0::Strand account_strand {thread_pool};
+    double balance = 0.0; // touched only by tasks running on account_strand - no mutex needed
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        account_strand.post([&balance] { balance += 1.0; });
+        account_strand.post([&balance] { balance -= 0.5; });
+    }
+
+    std::cout << "Balance: " << account_strand.submit([&balance] { return balance; }).get() << std::endl;
+
+    {
+        ver_2_0::Executors executors;
+
+        // the saves sleep in the blocking pool - they hold up no compute worker
+        std::vector<std::future<void>> saves;
+        for (const std::string filename : {"data1.txt", "data2.txt", "data3.txt"})
+            saves.push_back(executors.blocking().submit([filename] { save_to_file(filename); }));
+
+        std::future<int> fs11 = executors.compute().submit([] { return calculate_square(11); });
+        std::cout << "11 * 11 = " << fs11.get() << std::endl;
+
+        for (auto& save : saves)
+            save.get();
+    }
+
+    std::cout << "Missed deadlines: " << thread_pool.deadline_misses() << std::endl;
+
+    const ver_2_0::ThreadPoolMetrics metrics = thread_pool.metrics();
+    std::cout << "Tasks executed: " << metrics.tasks_executed << " (stolen: " << metrics.tasks_stolen << ")"
+              << ", queue wait p50/p99: " << metrics.queue_wait.quantile(0.5).count() << "/" << metrics.queue_wait.quantile(0.99).count() << "us"
+              << ", run time p99: " << metrics.run_time.quantile(0.99).count() << "us"
+              << ", affinity respected: " << metrics.affinity_respected << "/" << metrics.tasks_with_affinity << std::endl;
+
+#ifdef THREAD_POOL_TRACING
+    std::ofstream trace_file {"thread_pool_trace.json"};
+    thread_pool.write_trace(trace_file);
+#endif
 
     std::cout << "Main thread ends..." << std::endl;
 }
@@ -0,0 +1,177 @@
+#ifndef POOL_METRICS_HPP
+#define POOL_METRICS_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace ver_2_0
+{
+    // log2 histogram of durations: bucket 0 - below 1us, bucket i - [2^(i-1), 2^i) us, the last one is open
+    struct DurationHistogram
+    {
+        static constexpr size_t bucket_count = 32;
+
+        std::array<uint64_t, bucket_count> counts {};
+
+        static size_t bucket(std::chrono::steady_clock::duration duration)
+        {
+            const auto us = std::chrono::duration_cast<std::chrono::microseconds>(duration).count();
+            if (us <= 0)
+                return 0;
+            return std::min<size_t>(std::bit_width(static_cast<uint64_t>(us)), bucket_count - 1);
+        }
+
+        // exclusive upper bound of the bucket
+        static std::chrono::microseconds bucket_limit(size_t bucket)
+        {
+            return std::chrono::microseconds {uint64_t {1} << bucket};
+        }
+
+        uint64_t count() const
+        {
+            uint64_t total = 0;
+            for (uint64_t n : counts)
+                total += n;
+            return total;
+        }
+
+        // upper bound of the bucket holding the given quantile (0.5 - median, 0.99 - p99)
+        std::chrono::microseconds quantile(double q) const
+        {
+            const uint64_t total = count();
+            if (total == 0)
+                return std::chrono::microseconds::zero();
+
+            const auto rank = static_cast<uint64_t>(q * static_cast<double>(total - 1));
+            uint64_t seen = 0;
+            for (size_t i = 0; i < bucket_count; ++i)
+            {
+                seen += counts[i];
+                if (seen > rank)
+                    return bucket_limit(i);
+            }
+
+            return bucket_limit(bucket_count - 1);
+        }
+
+        DurationHistogram& operator+=(const DurationHistogram& other)
+        {
+            for (size_t i = 0; i < bucket_count; ++i)
+                counts[i] += other.counts[i];
+            return *this;
+        }
+    };
+
+    struct WorkerMetrics
+    {
+        uint64_t tasks_executed = 0;
+        uint64_t tasks_stolen = 0; // taken from the local queues of other workers
+        std::chrono::steady_clock::duration busy_time {};
+        double busy_ratio = 0.0; // busy_time / ThreadPoolMetrics::uptime
+    };
+
+    // point-in-time view of ThreadPool counters; all counters are cumulative since the pool was created,
+    // so rates over an interval are differences of two snapshots (see tasks_per_second())
+    struct ThreadPoolMetrics
+    {
+        std::chrono::steady_clock::time_point taken_at {};
+        std::chrono::steady_clock::duration uptime {};
+        size_t threads = 0;
+        size_t queued = 0;
+        uint64_t tasks_submitted = 0;
+        uint64_t tasks_executed = 0;
+        uint64_t tasks_stolen = 0;
+        uint64_t tasks_rejected = 0;  // refused by admission control (OverflowPolicy::reject)
+        uint64_t tasks_dropped = 0;   // queued, then discarded by drop_oldest or CoDel shedding
+        uint64_t tasks_cancelled = 0; // discarded because stop was requested before they started
+        uint64_t tasks_with_affinity = 0; // executed tasks submitted by a worker with a TaskAffinity hint
+        uint64_t affinity_respected = 0;  // ... of which ran where the hint asked for
+        uint64_t pin_failures = 0; // workers started unpinned because they could not be pinned to their cpu
+        DurationHistogram queue_wait;
+        DurationHistogram run_time;
+        std::vector<WorkerMetrics> workers; // per worker slot
+
+        double tasks_per_second() const
+        {
+            const double seconds = std::chrono::duration<double>(uptime).count();
+            return seconds > 0.0 ? static_cast<double>(tasks_executed) / seconds : 0.0;
+        }
+    };
+
+    inline double tasks_per_second(const ThreadPoolMetrics& earlier, const ThreadPoolMetrics& later)
+    {
+        const double seconds = std::chrono::duration<double>(later.taken_at - earlier.taken_at).count();
+        return seconds > 0.0 ? static_cast<double>(later.tasks_executed - earlier.tasks_executed) / seconds : 0.0;
+    }
+
+    namespace detail
+    {
+        // counters of one worker slot - written only by the thread occupying the slot (plain load + store, no RMW),
+        // read by snapshots; on its own cache lines, so workers never share a line they write
+        struct alignas(64) WorkerCounters
+        {
+            void record(std::chrono::steady_clock::duration queue_wait, std::chrono::steady_clock::duration run_time,
+                bool nested)
+            {
+                increment(tasks_executed);
+                increment(queue_wait_counts[DurationHistogram::bucket(queue_wait)]);
+                increment(run_time_counts[DurationHistogram::bucket(run_time)]);
+
+                if (!nested) // time of nested tasks (helping wait) is already part of the outer task
+                    busy_ns.store(busy_ns.load(std::memory_order_relaxed) + std::chrono::nanoseconds {run_time}.count(),
+                        std::memory_order_relaxed);
+            }
+
+            void record_steal()
+            {
+                increment(tasks_stolen);
+            }
+
+            void record_affinity(bool respected)
+            {
+                increment(tasks_with_affinity);
+                if (respected)
+                    increment(affinity_respected);
+            }
+
+            void collect(ThreadPoolMetrics& pool, WorkerMetrics& worker) const
+            {
+                pool.tasks_with_affinity += tasks_with_affinity.load(std::memory_order_relaxed);
+                pool.affinity_respected += affinity_respected.load(std::memory_order_relaxed);
+
+                worker.tasks_executed = tasks_executed.load(std::memory_order_relaxed);
+                worker.tasks_stolen = tasks_stolen.load(std::memory_order_relaxed);
+                worker.busy_time = std::chrono::nanoseconds {busy_ns.load(std::memory_order_relaxed)};
+
+                for (size_t i = 0; i < DurationHistogram::bucket_count; ++i)
+                {
+                    pool.queue_wait.counts[i] += queue_wait_counts[i].load(std::memory_order_relaxed);
+                    pool.run_time.counts[i] += run_time_counts[i].load(std::memory_order_relaxed);
+                }
+            }
+
+            size_t depth = 0; // tasks currently executing on the slot's thread (> 1 - helping wait); owner only
+
+        private:
+            static void increment(std::atomic<uint64_t>& counter)
+            {
+                counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            }
+
+            std::atomic<uint64_t> tasks_executed {0};
+            std::atomic<uint64_t> tasks_stolen {0};
+            std::atomic<int64_t> busy_ns {0};
+            std::atomic<uint64_t> tasks_with_affinity {0};
+            std::atomic<uint64_t> affinity_respected {0};
+            std::array<std::atomic<uint64_t>, DurationHistogram::bucket_count> queue_wait_counts {};
+            std::array<std::atomic<uint64_t>, DurationHistogram::bucket_count> run_time_counts {};
+        };
+    }
+}
+
+#endif // POOL_METRICS_HPP
@@ -0,0 +1,171 @@
+#ifndef STRAND_HPP
+#define STRAND_HPP
+
+#include "thread_pool.hpp"
+
+#include <atomic>
+#include <future>
+#include <memory>
+#include <thread>
+
+namespace ver_2_0
+{
+    // serial executor over a ThreadPool: tasks posted to a strand run one at a time, in FIFO order,
+    // on whichever worker picks the strand up; the strand owns no thread and never blocks a worker
+    class Strand
+    {
+    public:
+        explicit Strand(ThreadPool& pool, size_t batch_size = 64)
+            : impl_ {std::make_shared<Impl>(pool, batch_size)}
+        {
+        }
+
+        Strand(const Strand&) = delete;
+        Strand& operator=(const Strand&) = delete;
+
+        // the task must not throw
+        void post(Task task)
+        {
+            if (!task)
+                throw std::invalid_argument("Empty function is not supported");
+
+            Impl::post(impl_, new Impl::Node {std::move(task)});
+        }
+
+        template <typename Callable>
+        auto submit(Callable&& callable) -> std::future<decltype(callable())>
+        {
+            using ResultT = decltype(callable());
+
+            auto pt = std::make_shared<std::packaged_task<ResultT()>>(std::forward<Callable>(callable));
+            std::future<ResultT> fresult = pt->get_future();
+
+            post([pt] { (*pt)(); });
+
+            return fresult;
+        }
+
+        bool running_in_this_thread() const
+        {
+            return impl_->owner.load(std::memory_order_relaxed) == std::this_thread::get_id();
+        }
+
+    private:
+        struct Impl : std::enable_shared_from_this<Impl>
+        {
+            struct Node
+            {
+                Task task;
+                std::atomic<Node*> next {nullptr};
+            };
+
+            Impl(ThreadPool& pool, size_t batch_size)
+                : pool {pool}
+                , batch_size {batch_size}
+            {
+            }
+
+            ~Impl()
+            {
+                while (Node* node = pop())
+                    if (node != &stub)
+                        delete node;
+            }
+
+            static void post(const std::shared_ptr<Impl>& self, Node* node)
+            {
+                // counted before the push, so the draining worker never sees more tasks than pending
+                const bool idle = self->pending.fetch_add(1, std::memory_order_acq_rel) == 0;
+
+                self->push(node);
+
+                if (idle)
+                    self->pool.dispatch([self] { self->drain(); });
+            }
+
+            // Vyukov's intrusive MPSC queue - producers never wait for each other
+            void push(Node* node)
+            {
+                node->next.store(nullptr, std::memory_order_relaxed);
+                Node* prev = head.exchange(node, std::memory_order_acq_rel);
+                prev->next.store(node, std::memory_order_release);
+            }
+
+            // single consumer; returns nullptr when empty or when a producer is half-way through push()
+            Node* pop()
+            {
+                Node* first = tail;
+                Node* next = first->next.load(std::memory_order_acquire);
+
+                if (first == &stub)
+                {
+                    if (!next)
+                        return nullptr;
+                    tail = next;
+                    first = next;
+                    next = next->next.load(std::memory_order_acquire);
+                }
+
+                if (next)
+                {
+                    tail = next;
+                    return first;
+                }
+
+                if (first != head.load(std::memory_order_acquire))
+                    return nullptr;
+
+                push(&stub);
+
+                next = first->next.load(std::memory_order_acquire);
+                if (next)
+                {
+                    tail = next;
+                    return first;
+                }
+
+                return nullptr;
+            }
+
+            // runs a batch of tasks, then gives the worker back to the pool if more are pending
+            void drain()
+            {
+                owner.store(std::this_thread::get_id(), std::memory_order_relaxed);
+
+                size_t executed = 0;
+                while (executed < batch_size)
+                {
+                    Node* node = pop();
+                    if (!node)
+                    {
+                        if (executed == pending.load(std::memory_order_acquire))
+                            break;
+                        std::this_thread::yield(); // a producer has not pushed its node yet
+                        continue;
+                    }
+
+                    node->task();
+                    delete node;
+                    ++executed;
+                }
+
+                owner.store(std::thread::id {}, std::memory_order_relaxed);
+
+                if (pending.fetch_sub(executed, std::memory_order_acq_rel) != executed)
+                    pool.dispatch([self = shared_from_this()] { self->drain(); });
+            }
+
+            ThreadPool& pool;
+            const size_t batch_size;
+            std::atomic<size_t> pending {0};
+            std::atomic<std::thread::id> owner {};
+            Node stub;
+            std::atomic<Node*> head {&stub};
+            Node* tail {&stub};
+        };
+
+        std::shared_ptr<Impl> impl_;
+    };
+}
+
+#endif // STRAND_HPP
@@ -0,0 +1,140 @@
+#ifndef TASK_TRACE_HPP
+#define TASK_TRACE_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+namespace ver_2_0
+{
+    struct TraceEvent
+    {
+        const char* name; // nullptr - unnamed task
+        std::chrono::steady_clock::time_point enqueued_at;
+        std::chrono::steady_clock::time_point started_at;
+        std::chrono::steady_clock::time_point finished_at;
+    };
+
+    // append-only event buffer with a single writer (the owning worker); readers may iterate concurrently
+    // and see every event published before they started - neither side takes a lock
+    class TraceBuffer
+    {
+    public:
+        TraceBuffer() = default;
+
+        TraceBuffer(const TraceBuffer&) = delete;
+        TraceBuffer& operator=(const TraceBuffer&) = delete;
+
+        ~TraceBuffer()
+        {
+            for (Chunk* chunk = first_.next.load(); chunk;)
+            {
+                Chunk* next = chunk->next.load();
+                delete chunk;
+                chunk = next;
+            }
+        }
+
+        void record(const TraceEvent& event)
+        {
+            const size_t size = size_.load(std::memory_order_relaxed);
+
+            if (size != 0 && size % chunk_size == 0)
+            {
+                Chunk* chunk = new Chunk;
+                tail_->next.store(chunk, std::memory_order_release);
+                tail_ = chunk;
+            }
+
+            tail_->events[size % chunk_size] = event;
+            size_.store(size + 1, std::memory_order_release);
+        }
+
+        template <typename Function>
+        void for_each(Function function) const
+        {
+            const size_t size = size_.load(std::memory_order_acquire);
+
+            const Chunk* chunk = &first_;
+            for (size_t i = 0; i < size; ++i)
+            {
+                if (i != 0 && i % chunk_size == 0)
+                    chunk = chunk->next.load(std::memory_order_acquire);
+
+                function(chunk->events[i % chunk_size]);
+            }
+        }
+
+    private:
+        static constexpr size_t chunk_size = 1024;
+
+        struct Chunk
+        {
+            TraceEvent events[chunk_size];
+            std::atomic<Chunk*> next {nullptr};
+        };
+
+        Chunk first_;
+        Chunk* tail_ = &first_;
+        std::atomic<size_t> size_ {0};
+    };
+
+    namespace detail
+    {
+        inline void write_json_string(std::ostream& out, const char* text)
+        {
+            out << '"';
+            for (; *text; ++text)
+            {
+                const char c = *text;
+                if (c == '"' || c == '\\')
+                    out << '\\' << c;
+                else if (static_cast<unsigned char>(c) < 0x20)
+                    out << ' ';
+                else
+                    out << c;
+            }
+            out << '"';
+        }
+    }
+
+    // Chrome trace event format (chrome://tracing, ui.perfetto.dev); one track per buffer
+    inline void write_chrome_trace(std::ostream& out, const std::vector<const TraceBuffer*>& buffers,
+        std::chrono::steady_clock::time_point origin)
+    {
+        const auto micros = [origin](std::chrono::steady_clock::time_point tp) {
+            return std::chrono::duration<double, std::micro>(tp - origin).count();
+        };
+
+        out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+
+        bool first = true;
+        const auto separator = [&out, &first] {
+            if (!first)
+                out << ",\n";
+            first = false;
+        };
+
+        for (size_t tid = 0; tid < buffers.size(); ++tid)
+        {
+            separator();
+            out << R"({"name":"thread_name","ph":"M","pid":1,"tid":)" << tid << R"(,"args":{"name":"worker#)" << tid << "\"}}";
+
+            buffers[tid]->for_each([&](const TraceEvent& event) {
+                separator();
+                out << "{\"name\":";
+                detail::write_json_string(out, event.name ? event.name : "task");
+                out << R"(,"cat":"task","ph":"X","pid":1,"tid":)" << tid
+                    << ",\"ts\":" << micros(event.started_at)
+                    << ",\"dur\":" << micros(event.finished_at) - micros(event.started_at)
+                    << R"(,"args":{"queue_wait_us":)" << micros(event.started_at) - micros(event.enqueued_at) << "}}";
+            });
+        }
+
+        out << "]}\n";
+    }
+}
+
+#endif // TASK_TRACE_HPP
@@ -0,0 +1,149 @@
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "thread_pool.hpp"
+#include "test_utils.hpp"
+
+using namespace std;
+using namespace std::literals;
+
+TEST_CASE("ThreadPool - overflow policies")
+{
+    ver_2_0::ThreadPoolOptions options {1, 1};
+    options.max_queued = 2;
+
+    SECTION("block - the submitter waits for room")
+    {
+        options.overflow = ver_2_0::OverflowPolicy::block;
+        ver_2_0::ThreadPool pool {options};
+        BusyWorker busy {pool};
+
+        auto first = pool.submit([] { return 1; });
+        auto second = pool.submit([] { return 2; });
+
+        atomic<bool> submitted {false};
+        auto third = async(launch::async, [&] {
+            auto f = pool.submit([] { return 3; });
+            submitted = true;
+            return f.get();
+        });
+
+        this_thread::sleep_for(50ms);
+        REQUIRE(submitted == false);
+
+        busy.release();
+
+        REQUIRE(third.get() == 3);
+        REQUIRE(first.get() + second.get() == 3);
+    }
+
+    SECTION("reject - TaskRejected is thrown and counted")
+    {
+        options.overflow = ver_2_0::OverflowPolicy::reject;
+        ver_2_0::ThreadPool pool {options};
+        BusyWorker busy {pool};
+
+        auto first = pool.submit([] {});
+        auto second = pool.submit([] {});
+
+        REQUIRE_THROWS_AS(pool.submit([] {}), ver_2_0::TaskRejected);
+        REQUIRE_THROWS_AS(pool.post([] {}), ver_2_0::TaskRejected);
+        REQUIRE(pool.metrics().tasks_rejected == 2);
+    }
+
+    SECTION("caller_runs - the submitter runs the task itself")
+    {
+        options.overflow = ver_2_0::OverflowPolicy::caller_runs;
+        ver_2_0::ThreadPool pool {options};
+        BusyWorker busy {pool};
+
+        auto first = pool.submit([] {});
+        auto second = pool.submit([] {});
+
+        auto third = pool.submit([] { return this_thread::get_id(); });
+
+        REQUIRE(third.wait_for(0s) == future_status::ready);
+        REQUIRE(third.get() == this_thread::get_id());
+    }
+
+    SECTION("drop_oldest - the oldest queued task makes room and its future is broken")
+    {
+        options.overflow = ver_2_0::OverflowPolicy::drop_oldest;
+        ver_2_0::ThreadPool pool {options};
+
+        future<int> first;
+        future<int> second;
+        future<int> third;
+        {
+            BusyWorker busy {pool};
+
+            first = pool.submit([] { return 1; });
+            second = pool.submit([] { return 2; });
+            third = pool.submit([] { return 3; });
+        }
+
+        REQUIRE_THROWS_AS(first.get(), future_error);
+        REQUIRE(second.get() == 2);
+        REQUIRE(third.get() == 3);
+        REQUIRE(pool.metrics().tasks_dropped == 1);
+    }
+
+    SECTION("tasks submitted by workers are always admitted")
+    {
+        options.overflow = ver_2_0::OverflowPolicy::reject;
+        ver_2_0::ThreadPool pool {options};
+
+        const int sum = pool.submit([&pool] {
+                vector<future<int>> children;
+                for (int i = 0; i < 10; ++i)
+                    children.push_back(pool.submit([i] { return i; }));
+
+                int sum = 0;
+                for (auto& child : children)
+                    sum += pool.get(child);
+                return sum;
+            }).get();
+
+        REQUIRE(sum == 45);
+        REQUIRE(pool.metrics().tasks_rejected == 0);
+    }
+}
+
+TEST_CASE("ThreadPool - CoDel load shedding")
+{
+    ver_2_0::ThreadPoolOptions options {1, 1};
+    options.codel_target = 1ms;
+    options.codel_interval = 10ms;
+
+    ver_2_0::ThreadPool pool {options};
+
+    const int count = 200;
+
+    vector<future<void>> futures;
+    for (int i = 0; i < count; ++i)
+        futures.push_back(pool.submit([] { this_thread::sleep_for(1ms); }));
+
+    int executed = 0;
+    int dropped = 0;
+    for (auto& f : futures)
+    {
+        try
+        {
+            f.get();
+            ++executed;
+        }
+        catch (const future_error&)
+        {
+            ++dropped;
+        }
+    }
+
+    REQUIRE(dropped > 0); // a standing queue of 200ms is far above the target
+    REQUIRE(executed > 0);
+    REQUIRE(pool.metrics().tasks_dropped == static_cast<uint64_t>(dropped));
+}
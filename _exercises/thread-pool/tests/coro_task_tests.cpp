@@ -0,0 +1,163 @@
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+
+#include "catch.hpp"
+
+#include "coro_task.hpp"
+#include "test_utils.hpp"
+
+using namespace std;
+using namespace std::literals;
+
+namespace
+{
+    ver_2_0::CoroTask<int> square(int x)
+    {
+        co_return x * x;
+    }
+
+    ver_2_0::CoroTask<int> sum_of_squares(ver_2_0::ThreadPool& pool, thread::id& resumed_on)
+    {
+        co_await pool.schedule();
+        resumed_on = this_thread::get_id();
+
+        const int a = co_await square(2);
+        const int b = co_await square(3);
+
+        co_return a + b;
+    }
+
+    ver_2_0::CoroTask<int> failing()
+    {
+        throw runtime_error("failed");
+        co_return 0;
+    }
+
+    ver_2_0::CoroTask<int> count_down(int n)
+    {
+        if (n == 0)
+            co_return 0;
+
+        co_return co_await count_down(n - 1) + 1;
+    }
+
+    ver_2_0::CoroTask<thread::id> thread_of_start()
+    {
+        co_return this_thread::get_id();
+    }
+}
+
+TEST_CASE("CoroTask - awaiting")
+{
+    ver_2_0::ThreadPool pool {2};
+
+    SECTION("a task starts only when awaited")
+    {
+        bool started = false;
+        auto task = [](bool& started) -> ver_2_0::CoroTask<> {
+            started = true;
+            co_return;
+        }(started);
+
+        REQUIRE(started == false);
+
+        ver_2_0::spawn(pool, std::move(task)).get();
+        REQUIRE(started);
+    }
+
+    SECTION("a long chain of awaits runs by symmetric transfer")
+    {
+        REQUIRE(ver_2_0::spawn(pool, count_down(10'000)).get() == 10'000);
+    }
+
+    SECTION("an exception propagates through co_await")
+    {
+        auto rethrowing = []() -> ver_2_0::CoroTask<int> {
+            try
+            {
+                co_await failing();
+            }
+            catch (const runtime_error&)
+            {
+                co_return -1;
+            }
+            co_return 0;
+        };
+
+        REQUIRE(ver_2_0::spawn(pool, rethrowing()).get() == -1);
+    }
+}
+
+TEST_CASE("CoroTask - spawn")
+{
+    ver_2_0::ThreadPool pool {2};
+
+    SECTION("the future gets the result of the coroutine")
+    {
+        thread::id resumed_on;
+
+        REQUIRE(ver_2_0::spawn(pool, sum_of_squares(pool, resumed_on)).get() == 13);
+        REQUIRE(resumed_on != this_thread::get_id());
+    }
+
+    SECTION("the future gets the exception of the coroutine")
+    {
+        REQUIRE_THROWS_AS(ver_2_0::spawn(pool, failing()).get(), runtime_error);
+    }
+
+    SECTION("a coroutine awaits a future without holding a worker")
+    {
+        auto waiting = [](ver_2_0::ThreadPool& pool, future<int> input) -> ver_2_0::CoroTask<int> {
+            co_return co_await pool.when_ready(std::move(input)) + 1;
+        };
+
+        promise<int> input;
+        future<int> result = ver_2_0::spawn(pool, waiting(pool, input.get_future()));
+
+        REQUIRE(pool.submit([] { return 1; }).get() == 1); // the pool is not blocked by the waiting coroutine
+
+        input.set_value(41);
+        REQUIRE(result.get() == 42);
+    }
+}
+
+TEST_CASE("CoroTask - spawn goes through admission control")
+{
+    ver_2_0::ThreadPoolOptions options {1, 1};
+    options.max_queued = 1;
+
+    SECTION("reject - TaskRejected reaches the future")
+    {
+        options.overflow = ver_2_0::OverflowPolicy::reject;
+        ver_2_0::ThreadPool pool {options};
+
+        BusyWorker busy {pool};
+        auto queued = pool.submit([] {});
+
+        future<thread::id> spawned = ver_2_0::spawn(pool, thread_of_start());
+
+        REQUIRE(spawned.wait_for(0s) == future_status::ready);
+        REQUIRE_THROWS_AS(spawned.get(), ver_2_0::TaskRejected);
+    }
+
+    SECTION("caller_runs - the coroutine starts on the spawning thread")
+    {
+        options.overflow = ver_2_0::OverflowPolicy::caller_runs;
+        ver_2_0::ThreadPool pool {options};
+
+        BusyWorker busy {pool};
+        auto queued = pool.submit([] {});
+
+        REQUIRE(ver_2_0::spawn(pool, thread_of_start()).get() == this_thread::get_id());
+    }
+
+    SECTION("a coroutine spawned into a queue with room is started by a worker")
+    {
+        options.overflow = ver_2_0::OverflowPolicy::reject;
+        ver_2_0::ThreadPool pool {options};
+
+        REQUIRE(ver_2_0::spawn(pool, thread_of_start()).get() != this_thread::get_id());
+    }
+}
@@ -0,0 +1,61 @@
+#include <vector>
+
+#include "catch.hpp"
+
+#include "cpu_topology.hpp"
+
+using namespace std;
+
+namespace
+{
+    // 2 packages with an L3 each, 2 cores per package, 2 SMT siblings per core (with its own L2)
+    CpuTopology two_packages()
+    {
+        vector<CpuTopology::Cpu> cpus;
+        for (int id = 0; id < 8; ++id)
+        {
+            const int core = id - id % 2;
+            const int package = id / 4;
+            cpus.push_back(CpuTopology::Cpu {id, package, core, core, package * 4});
+        }
+
+        return CpuTopology {cpus};
+    }
+}
+
+TEST_CASE("CpuTopology")
+{
+    const CpuTopology topology = two_packages();
+
+    SECTION("compact order fills SMT siblings and cores sharing caches first")
+    {
+        REQUIRE(topology.compact_order() == vector<int> {0, 1, 2, 3, 4, 5, 6, 7});
+    }
+
+    SECTION("scatter order spreads across packages and cores, SMT siblings last")
+    {
+        REQUIRE(topology.scatter_order() == vector<int> {0, 4, 2, 6, 1, 5, 3, 7});
+    }
+
+    SECTION("distance follows the cache hierarchy")
+    {
+        REQUIRE(topology.distance(0, 1) == 0);
+        REQUIRE(topology.distance(0, 2) == 2);
+        REQUIRE(topology.distance(0, 4) == 4);
+        REQUIRE(topology.distance(0, 99) == 4);
+    }
+
+    SECTION("cpu lists in the sysfs format")
+    {
+        REQUIRE(CpuTopology::parse_cpu_list("0-3,8,10-11") == vector<int> {0, 1, 2, 3, 8, 10, 11});
+        REQUIRE(CpuTopology::parse_cpu_list("").empty());
+    }
+
+    SECTION("the detected topology contains the cpus the process may run on")
+    {
+        const CpuTopology detected = CpuTopology::detect();
+
+        REQUIRE(detected.cpus().empty() == false);
+        REQUIRE(detected.compact_order().size() == detected.cpus().size());
+    }
+}
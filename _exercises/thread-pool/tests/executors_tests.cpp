@@ -0,0 +1,106 @@
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "executors.hpp"
+#include "test_utils.hpp"
+
+using namespace std;
+using namespace std::literals;
+
+TEST_CASE("BlockingSection")
+{
+    ver_2_0::ThreadPoolOptions options {2, 2};
+    options.keep_alive = 50ms;
+    options.max_compensating_threads = 2;
+
+    ver_2_0::ThreadPool pool {options};
+
+    promise<void> release;
+    shared_future<void> gate = release.get_future().share();
+    atomic<int> blocked {0};
+
+    const auto blocking_task = [&blocked, gate] {
+        ver_2_0::BlockingSection blocking;
+        ++blocked;
+        gate.wait();
+    };
+
+    SECTION("compensating workers keep the pool running while its workers block")
+    {
+        vector<future<void>> futures;
+        for (int i = 0; i < 2; ++i)
+            futures.push_back(pool.submit(blocking_task));
+
+        REQUIRE(eventually([&] { return blocked == 2; }));
+        REQUIRE(pool.size() == 4);
+        REQUIRE(pool.submit([] { return 1; }).wait_for(1s) == future_status::ready);
+
+        release.set_value();
+        for (auto& f : futures)
+            f.get();
+
+        REQUIRE(eventually([&] { return pool.size() == 2; })); // the surplus retires
+    }
+
+    SECTION("no more than max_compensating_threads are started")
+    {
+        vector<future<void>> futures;
+        for (int i = 0; i < 4; ++i)
+            futures.push_back(pool.submit(blocking_task));
+
+        REQUIRE(eventually([&] { return blocked == 4; }));
+        REQUIRE(pool.size() == 4);
+
+        release.set_value();
+        for (auto& f : futures)
+            f.get();
+    }
+
+    SECTION("outside of a pool worker it does nothing")
+    {
+        {
+            ver_2_0::BlockingSection blocking;
+            REQUIRE(pool.size() == 2);
+        }
+    }
+}
+
+TEST_CASE("Executors")
+{
+    ver_2_0::ExecutorsOptions options;
+    options.compute = ver_2_0::ThreadPoolOptions {2, 2};
+
+    ver_2_0::Executors executors {options};
+
+    SECTION("the blocking pool starts empty")
+    {
+        REQUIRE(executors.blocking().size() == 0);
+        REQUIRE(executors.compute().size() == 2);
+    }
+
+    SECTION("blocking tasks do not hold up compute tasks")
+    {
+        promise<void> release;
+        shared_future<void> gate = release.get_future().share();
+        atomic<int> started {0};
+
+        vector<future<void>> io;
+        for (int i = 0; i < 8; ++i)
+            io.push_back(executors.blocking().submit([&started, gate] {
+                ++started;
+                gate.wait();
+            }));
+
+        REQUIRE(eventually([&] { return started == 8; })); // a worker per blocking task
+        REQUIRE(executors.compute().submit([] { return 1; }).get() == 1);
+
+        release.set_value();
+        for (auto& f : io)
+            f.get();
+    }
+}
@@ -0,0 +1,3 @@
+#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_NO_POSIX_SIGNALS // the alternate signal stack of Catch 2.13.2 does not compile with glibc >= 2.34
+#include "catch.hpp"
@@ -0,0 +1,87 @@
+#include <chrono>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "thread_pool.hpp"
+#include "test_utils.hpp"
+
+using namespace std;
+using namespace std::literals;
+
+TEST_CASE("DurationHistogram")
+{
+    using ver_2_0::DurationHistogram;
+
+    SECTION("log2 buckets of microseconds")
+    {
+        REQUIRE(DurationHistogram::bucket(0ns) == 0);
+        REQUIRE(DurationHistogram::bucket(900ns) == 0);
+        REQUIRE(DurationHistogram::bucket(1us) == 1);
+        REQUIRE(DurationHistogram::bucket(3us) == 2);
+        REQUIRE(DurationHistogram::bucket(1024us) == 11);
+        REQUIRE(DurationHistogram::bucket(24h) == DurationHistogram::bucket_count - 1);
+    }
+
+    SECTION("quantiles are bucket upper bounds")
+    {
+        DurationHistogram histogram;
+        histogram.counts[DurationHistogram::bucket(3us)] = 98;
+        histogram.counts[DurationHistogram::bucket(1000us)] = 2;
+
+        REQUIRE(histogram.count() == 100);
+        REQUIRE(histogram.quantile(0.5) == 4us);
+        REQUIRE(histogram.quantile(0.99) == 1024us);
+        REQUIRE(DurationHistogram {}.quantile(0.5) == 0us);
+    }
+}
+
+TEST_CASE("ThreadPool - metrics")
+{
+    ver_2_0::ThreadPool pool {2};
+
+    const auto before = pool.metrics();
+
+    vector<future<void>> futures;
+    for (int i = 0; i < 100; ++i)
+        futures.push_back(pool.submit([] { this_thread::sleep_for(100us); }));
+    for (auto& f : futures)
+        f.get();
+
+    REQUIRE(eventually([&] { return pool.metrics().tasks_executed == 100; })); // counted after the future is set
+
+    const auto after = pool.metrics();
+
+    SECTION("counters")
+    {
+        REQUIRE(after.threads == 2);
+        REQUIRE(after.queued == 0);
+        REQUIRE(after.tasks_submitted == 100);
+        REQUIRE(after.queue_wait.count() == 100);
+        REQUIRE(after.run_time.count() == 100);
+        REQUIRE(after.run_time.quantile(0.5) >= 128us); // none ran for less than 100us
+    }
+
+    SECTION("per-worker busy time adds up to the run time")
+    {
+        chrono::steady_clock::duration busy {};
+        uint64_t executed = 0;
+        for (const auto& worker : after.workers)
+        {
+            busy += worker.busy_time;
+            executed += worker.tasks_executed;
+            REQUIRE(worker.busy_ratio <= 1.0);
+        }
+
+        REQUIRE(executed == 100);
+        REQUIRE(busy >= 100 * 100us);
+    }
+
+    SECTION("rates from two snapshots")
+    {
+        REQUIRE(ver_2_0::tasks_per_second(before, after) > 0.0);
+        REQUIRE(after.tasks_per_second() > 0.0);
+    }
+}
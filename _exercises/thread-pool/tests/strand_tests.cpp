@@ -0,0 +1,83 @@
+#include <atomic>
+#include <future>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "strand.hpp"
+
+using namespace std;
+
+TEST_CASE("Strand")
+{
+    ver_2_0::ThreadPool pool {4};
+    ver_2_0::Strand strand {pool, 8};
+
+    SECTION("tasks posted by many threads run one at a time, FIFO per producer")
+    {
+        const int producers = 4;
+        const int per_producer = 1000;
+
+        atomic<int> active {0};
+        atomic<bool> overlapped {false};
+        vector<int> last_seen(producers, -1); // written only inside the strand
+        atomic<bool> out_of_order {false};
+
+        vector<thread> threads;
+        for (int p = 0; p < producers; ++p)
+        {
+            threads.emplace_back([&, p] {
+                for (int i = 0; i < per_producer; ++i)
+                {
+                    strand.post([&, p, i] {
+                        if (active.fetch_add(1) != 0)
+                            overlapped = true;
+
+                        if (last_seen[p] != i - 1)
+                            out_of_order = true;
+                        last_seen[p] = i;
+
+                        active.fetch_sub(1);
+                    });
+                }
+            });
+        }
+
+        for (auto& thd : threads)
+            thd.join();
+
+        strand.submit([] {}).get(); // posted after all the others
+
+        REQUIRE(overlapped == false);
+        REQUIRE(out_of_order == false);
+        for (int p = 0; p < producers; ++p)
+            REQUIRE(last_seen[p] == per_producer - 1);
+    }
+
+    SECTION("submit returns the result through a future")
+    {
+        REQUIRE(strand.submit([] { return 42; }).get() == 42);
+    }
+
+    SECTION("running_in_this_thread is true only inside the strand")
+    {
+        REQUIRE(strand.running_in_this_thread() == false);
+        REQUIRE(strand.submit([&strand] { return strand.running_in_this_thread(); }).get());
+        REQUIRE(pool.submit([&strand] { return strand.running_in_this_thread(); }).get() == false);
+    }
+
+    SECTION("a strand never holds more than one worker")
+    {
+        promise<void> release;
+        shared_future<void> gate = release.get_future().share();
+
+        strand.post([gate] { gate.wait(); });
+        strand.post([] {});
+
+        REQUIRE(pool.submit([] { return 1; }).get() == 1); // other workers are free
+
+        release.set_value();
+        strand.submit([] {}).get();
+    }
+}
@@ -0,0 +1,87 @@
+#include <chrono>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "task_trace.hpp"
+#include "thread_pool.hpp"
+#include "test_utils.hpp"
+
+using namespace std;
+using namespace std::literals;
+
+namespace
+{
+    size_t count_of(const string& text, const string& pattern)
+    {
+        size_t count = 0;
+        for (auto pos = text.find(pattern); pos != string::npos; pos = text.find(pattern, pos + 1))
+            ++count;
+        return count;
+    }
+}
+
+TEST_CASE("TraceBuffer")
+{
+    ver_2_0::TraceBuffer buffer;
+    const auto origin = chrono::steady_clock::now();
+
+    SECTION("keeps every event in order across chunks")
+    {
+        for (int i = 0; i < 2500; ++i)
+            buffer.record(ver_2_0::TraceEvent {nullptr, origin, origin + i * 1us, origin + i * 1us});
+
+        int expected = 0;
+        bool in_order = true;
+        buffer.for_each([&](const ver_2_0::TraceEvent& event) {
+            in_order = in_order && event.started_at == origin + expected * 1us;
+            ++expected;
+        });
+
+        REQUIRE(expected == 2500);
+        REQUIRE(in_order);
+    }
+
+    SECTION("Chrome trace has a track per buffer and a complete event per task")
+    {
+        ver_2_0::TraceBuffer other;
+        buffer.record(ver_2_0::TraceEvent {"say \"hi\"", origin, origin + 10us, origin + 30us});
+        buffer.record(ver_2_0::TraceEvent {nullptr, origin, origin + 40us, origin + 50us});
+        other.record(ver_2_0::TraceEvent {"other", origin, origin + 5us, origin + 6us});
+
+        ostringstream out;
+        ver_2_0::write_chrome_trace(out, {&buffer, &other}, origin);
+        const string trace = out.str();
+
+        REQUIRE(trace.rfind("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", 0) == 0);
+        REQUIRE(count_of(trace, "\"ph\":\"M\"") == 2);
+        REQUIRE(count_of(trace, "\"ph\":\"X\"") == 3);
+        REQUIRE(trace.find(R"("name":"say \"hi\"")") != string::npos); // escaped
+        REQUIRE(trace.find(R"("name":"task")") != string::npos);       // unnamed
+        REQUIRE(trace.find(R"("ts":10,"dur":20,"args":{"queue_wait_us":10})") != string::npos);
+        REQUIRE(trace.find(R"("tid":1,"ts":5)") != string::npos);
+    }
+}
+
+TEST_CASE("ThreadPool - trace")
+{
+    ver_2_0::ThreadPool pool {2};
+
+    ver_2_0::TaskOptions options;
+    options.name = "traced";
+    pool.submit(options, [] {}).get();
+
+    const auto trace = [&pool] {
+        ostringstream out;
+        pool.write_trace(out);
+        return out.str();
+    };
+
+#ifdef THREAD_POOL_TRACING
+    REQUIRE(eventually([&] { return trace().find(R"("name":"traced")") != string::npos; })); // recorded after the future is set
+#else
+    REQUIRE(trace() == "{\"traceEvents\":[]}\n"); // nothing is recorded
+#endif
+}
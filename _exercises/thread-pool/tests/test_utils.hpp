@@ -0,0 +1,65 @@
+#ifndef TEST_UTILS_HPP
+#define TEST_UTILS_HPP
+
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <thread>
+
+#include "thread_pool.hpp"
+
+// polls pred for up to timeout - for state the pool reaches asynchronously
+template <typename Predicate>
+bool eventually(Predicate pred, std::chrono::milliseconds timeout = std::chrono::seconds {2})
+{
+    const auto until = std::chrono::steady_clock::now() + timeout;
+    while (!pred())
+    {
+        if (std::chrono::steady_clock::now() > until)
+            return false;
+        std::this_thread::sleep_for(std::chrono::milliseconds {1});
+    }
+    return true;
+}
+
+// occupies a worker of the pool until released (at the latest when destroyed)
+class BusyWorker
+{
+public:
+    explicit BusyWorker(ver_2_0::ThreadPool& pool)
+    {
+        std::atomic<bool> started {false};
+        done_ = pool.submit([&started, gate = release_.get_future().share()] {
+            started = true;
+            gate.wait();
+        });
+
+        while (!started)
+            std::this_thread::yield();
+    }
+
+    BusyWorker(const BusyWorker&) = delete;
+    BusyWorker& operator=(const BusyWorker&) = delete;
+
+    ~BusyWorker()
+    {
+        release();
+    }
+
+    void release()
+    {
+        if (released_)
+            return;
+
+        released_ = true;
+        release_.set_value();
+        done_.wait();
+    }
+
+private:
+    std::promise<void> release_;
+    std::future<void> done_;
+    bool released_ = false;
+};
+
+#endif // TEST_UTILS_HPP
@@ -0,0 +1,535 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <mutex>
+#include <numeric>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "cpu_topology.hpp"
+#include "thread_pool.hpp"
+#include "test_utils.hpp"
+
+using namespace std;
+using namespace std::literals;
+
+TEST_CASE("ThreadPool - elastic size")
+{
+    ver_2_0::ThreadPoolOptions options {1, 4};
+    options.spawn_threshold = 1ms;
+    options.keep_alive = 50ms;
+
+    ver_2_0::ThreadPool pool {options};
+
+    SECTION("starts with min_threads")
+    {
+        REQUIRE(pool.size() == 1);
+    }
+
+    SECTION("grows under a backlog, up to max_threads")
+    {
+        vector<future<void>> futures;
+        for (int i = 0; i < 32; ++i)
+            futures.push_back(pool.submit([] { this_thread::sleep_for(10ms); }));
+
+        size_t peak = 0;
+        for (auto& f : futures)
+        {
+            while (f.wait_for(1ms) != future_status::ready)
+                peak = max(peak, pool.size());
+        }
+
+        REQUIRE(peak > 1);
+        REQUIRE(peak <= 4);
+    }
+
+    SECTION("shrinks back to min_threads once idle for keep_alive")
+    {
+        vector<future<void>> futures;
+        for (int i = 0; i < 32; ++i)
+            futures.push_back(pool.submit([] { this_thread::sleep_for(10ms); }));
+        for (auto& f : futures)
+            f.get();
+
+        REQUIRE(eventually([&] { return pool.size() == 1; }));
+    }
+}
+
+TEST_CASE("ThreadPool - size bounds")
+{
+    SECTION("never shrinks below min_threads")
+    {
+        ver_2_0::ThreadPoolOptions options {2, 4};
+        options.spawn_threshold = 1ms;
+        options.keep_alive = 20ms;
+
+        ver_2_0::ThreadPool pool {options};
+
+        vector<future<void>> futures;
+        for (int i = 0; i < 32; ++i)
+            futures.push_back(pool.submit([] { this_thread::sleep_for(5ms); }));
+        for (auto& f : futures)
+            f.get();
+
+        REQUIRE(eventually([&] { return pool.size() == 2; }));
+        this_thread::sleep_for(100ms);
+        REQUIRE(pool.size() == 2);
+    }
+
+    SECTION("invalid bounds are rejected")
+    {
+        REQUIRE_THROWS_AS(ver_2_0::ThreadPool(ver_2_0::ThreadPoolOptions {4, 2}), invalid_argument);
+        REQUIRE_THROWS_AS(ver_2_0::ThreadPool(ver_2_0::ThreadPoolOptions {0, 0}), invalid_argument);
+    }
+}
+
+TEST_CASE("ThreadPool - grows for a fan-out submitted by a worker")
+{
+    ver_2_0::ThreadPoolOptions options {1, 8};
+    options.spawn_threshold = 1ms;
+
+    ver_2_0::ThreadPool pool {options};
+
+    const auto started_at = chrono::steady_clock::now();
+
+    pool.submit([&pool] {
+            vector<future<void>> children;
+            for (int i = 0; i < 16; ++i)
+                children.push_back(pool.submit([] { this_thread::sleep_for(50ms); }));
+            for (auto& child : children)
+                pool.wait(child);
+        }).get();
+
+    const auto elapsed = chrono::steady_clock::now() - started_at;
+
+    REQUIRE(pool.size() > 1);
+    REQUIRE(elapsed < 16 * 50ms / 2);
+}
+
+TEST_CASE("ThreadPool - min_threads 0")
+{
+    ver_2_0::ThreadPoolOptions options {0, 2};
+    options.keep_alive = 50ms;
+
+    ver_2_0::ThreadPool pool {options};
+
+    REQUIRE(pool.size() == 0);
+    REQUIRE(pool.submit([] { return 42; }).get() == 42);
+    REQUIRE(eventually([&] { return pool.size() == 0; }));
+}
+
+TEST_CASE("ThreadPool - cancellation")
+{
+    ver_2_0::ThreadPool pool {1};
+
+    SECTION("a task cancelled before it runs is discarded")
+    {
+        stop_source stop;
+        atomic<bool> ran {false};
+
+        future<void> cancelled;
+        {
+            BusyWorker busy {pool};
+            cancelled = pool.submit(stop.get_token(), [&ran] { ran = true; });
+            stop.request_stop();
+
+            REQUIRE(cancelled.wait_for(0s) == future_status::ready); // reported at once, not when dequeued
+        }
+
+        REQUIRE_THROWS_AS(cancelled.get(), ver_2_0::TaskCancelled);
+        pool.submit([] {}).get(); // the cancelled task has been dequeued by now
+        REQUIRE(ran == false);
+        REQUIRE(pool.metrics().tasks_cancelled == 1);
+    }
+
+    SECTION("a running task sees the stop request")
+    {
+        stop_source stop;
+        atomic<bool> started {false};
+
+        future<int> polling = pool.submit(stop.get_token(), [&started](stop_token token) {
+            started = true;
+            while (!token.stop_requested())
+                this_thread::yield();
+            return 1;
+        });
+
+        while (!started)
+            this_thread::yield();
+        stop.request_stop();
+
+        REQUIRE_THROWS_AS(polling.get(), ver_2_0::TaskCancelled);
+    }
+
+    SECTION("a task not cancelled runs as usual")
+    {
+        stop_source stop;
+
+        REQUIRE(pool.submit(stop.get_token(), [] { return 42; }).get() == 42);
+    }
+}
+
+TEST_CASE("ThreadPool - cancelled tasks hold no room in a full queue")
+{
+    ver_2_0::ThreadPoolOptions options {1, 1};
+    options.max_queued = 2;
+    options.overflow = ver_2_0::OverflowPolicy::reject;
+
+    ver_2_0::ThreadPool pool {options};
+    BusyWorker busy {pool};
+
+    stop_source stop;
+    auto first = pool.submit(stop.get_token(), [] {});
+    auto second = pool.submit(stop.get_token(), [] {});
+
+    REQUIRE_THROWS_AS(pool.submit([] {}), ver_2_0::TaskRejected);
+
+    stop.request_stop();
+
+    future<int> admitted;
+    REQUIRE_NOTHROW(admitted = pool.submit([] { return 1; }));
+    REQUIRE(pool.metrics().tasks_cancelled == 2);
+
+    busy.release();
+    REQUIRE(admitted.get() == 1);
+}
+
+TEST_CASE("ThreadPool - priorities and deadlines")
+{
+    ver_2_0::ThreadPool pool {1};
+
+    vector<int> order;
+    mutex mtx_order;
+    const auto record = [&](int id) {
+        return [&, id] {
+            lock_guard lk {mtx_order};
+            order.push_back(id);
+        };
+    };
+
+    vector<future<void>> futures;
+
+    SECTION("queued tasks run by priority class, FIFO within a class")
+    {
+        {
+            BusyWorker busy {pool};
+
+            futures.push_back(pool.submit({ver_2_0::TaskPriority::low}, record(1)));
+            futures.push_back(pool.submit({ver_2_0::TaskPriority::normal}, record(2)));
+            futures.push_back(pool.submit({ver_2_0::TaskPriority::high}, record(3)));
+            futures.push_back(pool.submit({ver_2_0::TaskPriority::normal}, record(4)));
+            futures.push_back(pool.submit({ver_2_0::TaskPriority::high}, record(5)));
+        }
+
+        for (auto& f : futures)
+            f.get();
+
+        REQUIRE(order == vector<int> {3, 5, 2, 4, 1});
+    }
+
+    SECTION("earliest deadline first within a class")
+    {
+        const auto now = ver_2_0::Clock::now();
+        {
+            BusyWorker busy {pool};
+
+            futures.push_back(pool.submit({ver_2_0::TaskPriority::normal}, record(1))); // no deadline - last
+            futures.push_back(pool.submit({ver_2_0::TaskPriority::normal, now + 3s}, record(2)));
+            futures.push_back(pool.submit({ver_2_0::TaskPriority::normal, now + 1s}, record(3)));
+            futures.push_back(pool.submit({ver_2_0::TaskPriority::high, now + 5s}, record(4)));
+        }
+
+        for (auto& f : futures)
+            f.get();
+
+        REQUIRE(order == vector<int> {4, 3, 2, 1});
+    }
+
+    SECTION("tasks that complete after their deadline are counted")
+    {
+        pool.submit({ver_2_0::TaskPriority::normal, ver_2_0::Clock::now() + 1h}, [] {}).get();
+        REQUIRE(pool.deadline_misses() == 0);
+
+        pool.submit({ver_2_0::TaskPriority::normal, ver_2_0::Clock::now()}, [] { this_thread::sleep_for(1ms); }).get();
+        REQUIRE(eventually([&] { return pool.deadline_misses() == 1; })); // counted after the future is set
+    }
+}
+
+TEST_CASE("ThreadPool - worker placement")
+{
+    const int cpu = CpuTopology::detect().cpus().front().id;
+
+    SECTION("cpu_list pins the workers round-robin")
+    {
+        ver_2_0::ThreadPoolOptions options {2, 2};
+        options.placement = ver_2_0::WorkerPlacement::cpu_list;
+        options.cpus = {cpu};
+
+        ver_2_0::ThreadPool pool {options};
+
+        for (int worker_cpu : pool.worker_cpus())
+            REQUIRE(worker_cpu == cpu);
+        REQUIRE(pool.submit([] { return 1; }).get() == 1);
+    }
+
+    SECTION("cpus the process may not run on are rejected")
+    {
+        ver_2_0::ThreadPoolOptions options {2, 2};
+        options.placement = ver_2_0::WorkerPlacement::cpu_list;
+        options.cpus = {-1};
+
+        REQUIRE_THROWS_AS(ver_2_0::ThreadPool {options}, invalid_argument);
+    }
+
+    SECTION("without a placement the workers float")
+    {
+        ver_2_0::ThreadPool pool {2};
+
+        for (int worker_cpu : pool.worker_cpus())
+            REQUIRE(worker_cpu == -1);
+    }
+}
+
+TEST_CASE("ThreadPool - idle workers steal from the local queue of a busy one")
+{
+    ver_2_0::ThreadPool pool {4};
+
+    const size_t run_by_parent = pool.submit([&pool] {
+            vector<future<thread::id>> children;
+            for (int i = 0; i < 8; ++i)
+                children.push_back(pool.submit([] {
+                    this_thread::sleep_for(10ms);
+                    return this_thread::get_id();
+                }));
+
+            size_t count = 0;
+            for (auto& child : children) // a plain get() - the parent does not help
+                if (child.get() == this_thread::get_id())
+                    ++count;
+            return count;
+        }).get();
+
+    REQUIRE(run_by_parent == 0);
+    REQUIRE(pool.metrics().tasks_stolen == 8);
+}
+
+TEST_CASE("ThreadPool - bulk submission")
+{
+    ver_2_0::ThreadPool pool {4};
+
+    SECTION("results in input order")
+    {
+        vector<int> items(1000);
+        iota(items.begin(), items.end(), 0);
+
+        auto batch = pool.submit_bulk(items.begin(), items.end(), [](int x) { return x * x; });
+
+        REQUIRE(batch.size() == 1000);
+        REQUIRE(batch.get(10) == 100);
+
+        const vector<int> results = batch.get();
+        for (int i = 0; i < 1000; ++i)
+            REQUIRE(results[i] == i * i);
+    }
+
+    SECTION("every item runs once for a void function")
+    {
+        vector<atomic<int>> calls(100);
+
+        auto batch = pool.submit_bulk(calls.begin(), calls.end(), [](atomic<int>& count) { ++count; });
+        batch.get();
+
+        REQUIRE(all_of(calls.begin(), calls.end(), [](const atomic<int>& count) { return count == 1; }));
+    }
+
+    SECTION("an exception is kept for its own item")
+    {
+        vector<int> items {1, 2, 3, 4};
+
+        auto batch = pool.submit_bulk(items.begin(), items.end(), [](int x) {
+            if (x == 3)
+                throw runtime_error("three");
+            return x;
+        });
+
+        REQUIRE(batch.get(1) == 2);
+        REQUIRE_THROWS_AS(batch.get(2), runtime_error);
+        REQUIRE(batch.get(3) == 4);
+        REQUIRE_THROWS_AS(batch.get(), runtime_error);
+    }
+
+    SECTION("an empty range is ready at once")
+    {
+        vector<int> items;
+
+        auto batch = pool.submit_bulk(items.begin(), items.end(), [](int x) { return x; });
+
+        REQUIRE(batch.wait_for(0s) == future_status::ready);
+        REQUIRE(batch.get().empty());
+    }
+}
+
+TEST_CASE("ThreadPool - bulk items of a dropped chunk get TaskRejected")
+{
+    ver_2_0::ThreadPoolOptions options {1, 1};
+    options.max_queued = 1;
+    options.overflow = ver_2_0::OverflowPolicy::drop_oldest;
+
+    ver_2_0::ThreadPool pool {options};
+
+    vector<int> items {1, 2, 3, 4};
+    ver_2_0::BatchFuture<int> batch;
+    {
+        BusyWorker busy {pool};
+
+        batch = pool.submit_bulk(items.begin(), items.end(), [](int x) { return x; }); // a batch fills an empty queue
+        pool.post([] {}); // drops every chunk to make room
+    }
+
+    for (size_t i = 0; i < items.size(); ++i)
+        REQUIRE_THROWS_AS(batch.get(i), ver_2_0::TaskRejected);
+    REQUIRE(pool.metrics().tasks_dropped == 4);
+}
+
+namespace
+{
+    int fibonacci(ver_2_0::ThreadPool& pool, int n)
+    {
+        if (n < 2)
+            return n;
+
+        auto first = pool.submit([&pool, n] { return fibonacci(pool, n - 1); });
+        const int second = fibonacci(pool, n - 2);
+
+        return pool.get(first) + second;
+    }
+}
+
+TEST_CASE("ThreadPool - helping wait")
+{
+    SECTION("a worker waiting for its child runs it instead of deadlocking a single-threaded pool")
+    {
+        ver_2_0::ThreadPool pool {1};
+
+        const bool same_thread = pool.submit([&pool] {
+                auto child = pool.submit([] { return this_thread::get_id(); });
+                return pool.get(child) == this_thread::get_id();
+            }).get();
+
+        REQUIRE(same_thread);
+    }
+
+    SECTION("recursive fan-out on a small pool")
+    {
+        ver_2_0::ThreadPool pool {2};
+
+        REQUIRE(pool.submit([&pool] { return fibonacci(pool, 15); }).get() == 610);
+    }
+
+    SECTION("waiting for a batch inside a worker")
+    {
+        ver_2_0::ThreadPool pool {1};
+
+        const int sum = pool.submit([&pool] {
+                vector<int> items {1, 2, 3};
+                auto batch = pool.submit_bulk(items.begin(), items.end(), [](int x) { return x * 10; });
+                pool.wait(batch);
+
+                const vector<int> results = batch.get();
+                return accumulate(results.begin(), results.end(), 0);
+            }).get();
+
+        REQUIRE(sum == 60);
+    }
+
+    SECTION("outside of the pool it is a plain wait")
+    {
+        ver_2_0::ThreadPool pool {1};
+
+        REQUIRE(pool.get(pool.submit([] { return 42; })) == 42);
+    }
+}
+
+TEST_CASE("ThreadPool - parked workers")
+{
+    ver_2_0::ThreadPool pool {4};
+
+    SECTION("a task submitted to a fully parked pool is not lost")
+    {
+        for (int i = 0; i < 200; ++i)
+        {
+            if (i % 20 == 0)
+                this_thread::sleep_for(5ms); // let every worker park
+
+            REQUIRE(pool.submit([i] { return i; }).wait_for(1s) == future_status::ready);
+        }
+    }
+
+    SECTION("a burst wakes enough workers to run it in parallel")
+    {
+        this_thread::sleep_for(20ms);
+
+        atomic<int> running {0};
+        atomic<int> peak {0};
+
+        vector<future<void>> futures;
+        for (int i = 0; i < 4; ++i)
+            futures.push_back(pool.submit([&] {
+                const int now = ++running;
+                int seen = peak;
+                while (now > seen && !peak.compare_exchange_weak(seen, now))
+                    ;
+
+                eventually([&] { return peak == 4; }, 1s);
+                --running;
+            }));
+
+        for (auto& f : futures)
+            f.get();
+
+        REQUIRE(peak == 4);
+    }
+}
+
+TEST_CASE("ThreadPool - locality hints")
+{
+    ver_2_0::ThreadPool pool {4};
+
+    ver_2_0::TaskOptions same_worker;
+    same_worker.affinity = ver_2_0::TaskAffinity::same_worker;
+
+    SECTION("a same_worker child runs on its parent's worker when the parent helps")
+    {
+        const bool on_parent = pool.submit([&] {
+                auto child = pool.submit(same_worker, [] { return this_thread::get_id(); });
+                return pool.get(child) == this_thread::get_id();
+            }).get();
+
+        REQUIRE(on_parent);
+
+        const auto metrics = pool.metrics();
+        REQUIRE(metrics.tasks_with_affinity == 1);
+        REQUIRE(metrics.affinity_respected == 1);
+    }
+
+    SECTION("a hinted child still runs when its parent blocks without helping")
+    {
+        const bool done = pool.submit([&] {
+                auto child = pool.submit(same_worker, [] { return 1; });
+                return child.wait_for(1s) == future_status::ready; // stolen after affinity_max_wait
+            }).get();
+
+        REQUIRE(done);
+    }
+
+    SECTION("hints are ignored for tasks submitted from outside of the pool")
+    {
+        REQUIRE(pool.submit(same_worker, [] { return 1; }).get() == 1);
+        REQUIRE(eventually([&] { return pool.metrics().tasks_executed == 1; }));
+        REQUIRE(pool.metrics().tasks_with_affinity == 0);
+    }
+}
@@ -0,0 +1,112 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <future>
+#include <memory>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "thread_pool.hpp"
+#include "test_utils.hpp"
+
+using namespace std;
+using namespace std::literals;
+
+TEST_CASE("TimerWheel")
+{
+    ver_2_0::detail::TimerWheel wheel {5};
+
+    // expiries on every level and on level boundaries
+    const vector<uint64_t> expiries {6, 68, 69, 4096, 4101, 300'000};
+
+    vector<unique_ptr<ver_2_0::detail::TimerNode>> nodes;
+    for (uint64_t expiry : expiries)
+    {
+        nodes.push_back(make_unique<ver_2_0::detail::TimerNode>());
+        nodes.back()->expiry = expiry;
+        wheel.insert(nodes.back().get());
+    }
+
+    REQUIRE(wheel.size() == expiries.size());
+
+    SECTION("every timer is due exactly at its expiry tick")
+    {
+        vector<ver_2_0::detail::TimerNode*> due;
+        vector<uint64_t> fired_at;
+
+        while (wheel.size() > 0)
+        {
+            const auto next = wheel.next_event();
+            REQUIRE(next.has_value());
+            REQUIRE(*next > wheel.current());
+
+            wheel.advance(*next, due); // nothing can expire before the next event
+            for (auto* node : due)
+            {
+                REQUIRE(node->expiry == wheel.current());
+                fired_at.push_back(wheel.current());
+            }
+            due.clear();
+        }
+
+        REQUIRE(fired_at == expiries);
+        REQUIRE(wheel.next_event().has_value() == false);
+    }
+
+    SECTION("a removed timer does not fire")
+    {
+        wheel.remove(nodes[2].get());
+        wheel.remove(nodes[5].get());
+
+        vector<ver_2_0::detail::TimerNode*> due;
+        wheel.advance(1'000'000, due);
+
+        REQUIRE(due.size() == expiries.size() - 2);
+        REQUIRE(find(due.begin(), due.end(), nodes[2].get()) == due.end());
+        REQUIRE(find(due.begin(), due.end(), nodes[5].get()) == due.end());
+    }
+}
+
+TEST_CASE("ThreadPool - timers")
+{
+    ver_2_0::ThreadPool pool {2};
+
+    SECTION("a delayed task runs on the pool after its delay")
+    {
+        promise<chrono::steady_clock::time_point> fired;
+        const auto scheduled_at = chrono::steady_clock::now();
+
+        pool.schedule_after(20ms, [&fired] { fired.set_value(chrono::steady_clock::now()); });
+
+        REQUIRE(fired.get_future().get() - scheduled_at >= 20ms);
+    }
+
+    SECTION("a cancelled delayed task does not run")
+    {
+        atomic<bool> ran {false};
+
+        auto handle = pool.schedule_after(50ms, [&ran] { ran = true; });
+
+        REQUIRE(handle.cancel());
+        REQUIRE(handle.cancel() == false); // only the first call prevents the run
+
+        this_thread::sleep_for(100ms);
+        REQUIRE(ran == false);
+    }
+
+    SECTION("a periodic task runs until cancelled")
+    {
+        atomic<int> runs {0};
+
+        auto handle = pool.schedule_every(5ms, [&runs] { ++runs; });
+
+        REQUIRE(eventually([&] { return runs >= 3; }));
+        REQUIRE(handle.cancel());
+
+        const int after_cancel = runs;
+        this_thread::sleep_for(50ms);
+        REQUIRE(runs <= after_cancel + 1); // a run already handed to the pool may still finish
+    }
+}
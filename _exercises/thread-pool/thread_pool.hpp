@@ -0,0 +1,1794 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include "cpu_topology.hpp"
+#include "future_watcher.hpp"
+#include "pool_metrics.hpp"
+#include "thread_safe_queue.hpp"
+#include "timer_wheel.hpp"
+
+#ifdef THREAD_POOL_TRACING
+#include "task_trace.hpp"
+#endif
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <stdexcept>
+#include <stop_token>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+using Task = std::function<void()>;
+
+namespace ver_1_0
+{
+    class ThreadPool
+    {
+    public:
+        static inline Task poisoning_pill {};
+
+        explicit ThreadPool(size_t size)
+            : threads_(size)
+        {
+            for (auto& thd : threads_)
+            {
+                // thd = std::thread{[this]{ run();}};
+                thd = std::thread {&ThreadPool::run, this};
+            }
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        ~ThreadPool()
+        {
+            for (size_t i = 0; i < threads_.size(); ++i)
+                send_poisoning_pill();
+
+            for (auto& thd : threads_)
+                if (thd.joinable())
+                    thd.join();
+        }
+
+        void submit(const Task& task)
+        {
+            if (is_poisoning_pill(task))
+                throw std::invalid_argument("Empty function is not supported");
+
+            q_tasks_.push(task);
+        }
+
+    private:
+        void send_poisoning_pill()
+        {
+            q_tasks_.push(poisoning_pill);
+        }
+
+        bool is_poisoning_pill(const Task& task) const
+        {
+            return task == nullptr;
+        }
+
+        void run()
+        {
+            Task task;
+            while (true)
+            {
+                q_tasks_.pop(task);
+                if (is_poisoning_pill(task))
+                    return;
+                task();
+            };
+        }
+
+        ThreadSafeQueue<Task> q_tasks_;
+        std::vector<std::thread> threads_;
+    };
+}
+
+namespace ver_1_1
+{
+    class ThreadPool
+    {
+    public:
+        explicit ThreadPool(size_t size)
+            : threads_(size)
+        {
+            for (auto& thd : threads_)
+            {
+                // thd = std::thread{[this]{ run();}};
+                thd = std::thread {&ThreadPool::run, this};
+            }
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        ~ThreadPool()
+        {
+            for (size_t i = 0; i < threads_.size(); ++i)
+                submit([this] { end_work_ = true; });
+
+            for (auto& thd : threads_)
+                if (thd.joinable())
+                    thd.join();
+        }
+
+        template <typename Callable>
+        auto submit(Callable&& callable) -> std::future<decltype(callable())>
+        {
+            using ResultT = decltype(callable());
+
+            auto pt = std::make_shared<std::packaged_task<ResultT()>>(std::forward<Callable>(callable));
+            std::future<ResultT> fresult = pt->get_future();
+
+            q_tasks_.push([pt] { (*pt)(); });
+
+            return fresult;
+        }
+
+    private:
+        void run()
+        {
+            Task task;
+            while (true)
+            {
+                q_tasks_.pop(task);
+
+                task();
+
+                if (end_work_)
+                    return;
+            };
+        }
+
+        ThreadSafeQueue<Task> q_tasks_;
+        std::vector<std::thread> threads_;
+        std::atomic<bool> end_work_{false};
+    };
+}
+
+namespace ver_2_0
+{
+    using Clock = std::chrono::steady_clock;
+
+    enum class TaskPriority : uint8_t
+    {
+        high,
+        normal,
+        low
+    };
+
+    // where a task submitted by a pool worker should run - data produced by the parent is still in its caches;
+    // ignored for tasks submitted from outside of the pool; a hint, not a pin - a task its worker has not got to
+    // within ThreadPoolOptions::affinity_max_wait may run anywhere
+    enum class TaskAffinity : uint8_t
+    {
+        any,
+        same_l3,    // the parent's worker or a worker sharing its L3 cache (known only for pinned workers)
+        same_worker // the parent's worker
+    };
+
+    struct TaskOptions
+    {
+        TaskPriority priority = TaskPriority::normal;
+        std::optional<Clock::time_point> deadline {};
+        const char* name = nullptr; // shown in the trace (THREAD_POOL_TRACING); must outlive the pool
+        TaskAffinity affinity = TaskAffinity::any;
+    };
+
+    // thrown by submit()/post() when the queue is full and the overflow policy is reject;
+    // stored for the items of a bulk submission whose chunk was dropped
+    class TaskRejected : public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    // stored in the future of a task submitted with a std::stop_token once stop has been requested
+    class TaskCancelled : public std::runtime_error
+    {
+    public:
+        using std::runtime_error::runtime_error;
+    };
+
+    class ThreadPool;
+
+    namespace detail
+    {
+        // identifies the pool worker running on the current thread
+        struct WorkerContext
+        {
+            ThreadPool* pool = nullptr;
+            size_t index = 0;
+        };
+
+        constexpr size_t no_worker = static_cast<size_t>(-1);
+
+        struct QueuedTask
+        {
+            Task task;
+            TaskPriority priority;
+            Clock::time_point deadline; // Clock::time_point::max() - no deadline
+            uint64_t seq;
+            Clock::time_point enqueued_at;
+            TaskAffinity affinity = TaskAffinity::any;
+            size_t origin = no_worker; // worker that submitted the task
+#ifdef THREAD_POOL_TRACING
+            const char* name = nullptr;
+#endif
+            bool droppable = true; // false for tasks the pool relies on (see ThreadPool::dispatch())
+            std::stop_token stop_token {}; // of a cancellable task - once stop is requested it need not run
+        };
+
+        // ordering for a max-heap: priority class first, then earliest deadline, then FIFO
+        struct LessUrgent
+        {
+            bool operator()(const QueuedTask& a, const QueuedTask& b) const
+            {
+                if (a.priority != b.priority)
+                    return a.priority > b.priority;
+                if (a.deadline != b.deadline)
+                    return a.deadline > b.deadline;
+                return a.seq > b.seq;
+            }
+        };
+
+        struct CoDelState
+        {
+            Clock::time_point first_above {}; // end of the interval the wait must stay above the target; {} - below it
+            Clock::time_point drop_next {};
+            size_t drop_count = 0;
+            bool dropping = false;
+        };
+
+        class TaskHeap
+        {
+        public:
+            bool empty() const
+            {
+                return tasks_.empty();
+            }
+
+            size_t size() const
+            {
+                return tasks_.size();
+            }
+
+            const QueuedTask& top() const
+            {
+                return tasks_.front();
+            }
+
+            void push(QueuedTask&& task)
+            {
+                tasks_.push_back(std::move(task));
+                std::push_heap(tasks_.begin(), tasks_.end(), LessUrgent {});
+            }
+
+            QueuedTask pop()
+            {
+                std::pop_heap(tasks_.begin(), tasks_.end(), LessUrgent {});
+                QueuedTask task = std::move(tasks_.back());
+                tasks_.pop_back();
+                return task;
+            }
+
+            // O(n) - used only when a full queue has to make room; nullopt if no task may be dropped
+            std::optional<QueuedTask> pop_oldest_droppable()
+            {
+                auto oldest = tasks_.end();
+                for (auto it = tasks_.begin(); it != tasks_.end(); ++it)
+                    if (it->droppable && (oldest == tasks_.end() || it->seq < oldest->seq))
+                        oldest = it;
+
+                if (oldest == tasks_.end())
+                    return std::nullopt;
+
+                QueuedTask task = std::move(*oldest);
+                *oldest = std::move(tasks_.back());
+                tasks_.pop_back();
+                std::make_heap(tasks_.begin(), tasks_.end(), LessUrgent {});
+                return task;
+            }
+
+            // O(n) - moves the tasks whose stop has been requested to purged; returns how many there were
+            size_t purge_cancelled(std::vector<QueuedTask>& purged)
+            {
+                auto cancelled = std::partition(tasks_.begin(), tasks_.end(),
+                    [](const QueuedTask& task) { return !task.stop_token.stop_requested(); });
+
+                const size_t count = tasks_.end() - cancelled;
+                if (count == 0)
+                    return 0;
+
+                std::move(cancelled, tasks_.end(), std::back_inserter(purged));
+                tasks_.erase(cancelled, tasks_.end());
+                std::make_heap(tasks_.begin(), tasks_.end(), LessUrgent {});
+                return count;
+            }
+
+        private:
+            std::vector<QueuedTask> tasks_;
+        };
+    }
+
+    namespace detail
+    {
+        template <typename T>
+        struct BatchState
+        {
+            using StoredT = std::conditional_t<std::is_void_v<T>, char, T>;
+
+            explicit BatchState(size_t size)
+                : values(std::is_void_v<T> ? 0 : size)
+                , errors(size)
+                , completed {done.get_future().share()}
+            {
+            }
+
+            template <typename Function, typename Arg>
+            void run_item(size_t index, Function& function, Arg&& arg)
+            {
+                try
+                {
+                    if constexpr (std::is_void_v<T>)
+                        function(std::forward<Arg>(arg));
+                    else
+                        values[index].emplace(function(std::forward<Arg>(arg)));
+                }
+                catch (...)
+                {
+                    errors[index] = std::current_exception();
+                }
+            }
+
+            // true for the last chunk of the batch, which sets done
+            bool finish_chunk()
+            {
+                return pending_chunks.fetch_sub(1, std::memory_order_acq_rel) == 1;
+            }
+
+            std::vector<std::optional<StoredT>> values;
+            std::vector<std::exception_ptr> errors;
+            std::atomic<size_t> pending_chunks {0};
+            std::promise<void> done;
+            std::shared_future<void> completed;
+        };
+
+        // owned by the task of one bulk chunk - if the task is destroyed without running (dropped by admission
+        // control), its items fail with TaskRejected, so the batch still completes
+        template <typename T>
+        struct BatchChunk
+        {
+            BatchChunk(std::shared_ptr<BatchState<T>> state, size_t first, size_t last)
+                : state {std::move(state)}
+                , first {first}
+                , last {last}
+            {
+            }
+
+            BatchChunk(const BatchChunk&) = delete;
+            BatchChunk& operator=(const BatchChunk&) = delete;
+
+            ~BatchChunk()
+            {
+                if (started)
+                    return;
+
+                for (size_t index = first; index < last; ++index)
+                    state->errors[index] = std::make_exception_ptr(TaskRejected {"Task dropped by admission control"});
+
+                if (state->finish_chunk())
+                    state->done.set_value();
+            }
+
+            std::shared_ptr<BatchState<T>> state;
+            const size_t first;
+            const size_t last;
+            bool started = false;
+        };
+    }
+
+    namespace detail
+    {
+        template <typename Function>
+        constexpr bool takes_stop_token = std::is_invocable_v<Function&, std::stop_token>;
+
+        template <typename Function>
+        using CancellableResultT = typename std::conditional_t<takes_stop_token<Function>,
+            std::invoke_result<Function&, std::stop_token>, std::invoke_result<Function&>>::type;
+
+        // the promise of a cancellable task is settled once - by the task or by the stop callback, whichever is first
+        template <typename Function>
+        struct CancellableState
+        {
+            using ResultT = CancellableResultT<Function>;
+
+            struct OnStop
+            {
+                CancellableState* state;
+
+                void operator()() const
+                {
+                    state->settle([this] {
+                        state->promise.set_exception(std::make_exception_ptr(TaskCancelled {"Task has been cancelled"}));
+                    });
+                }
+            };
+
+            template <typename F>
+            CancellableState(F&& function, std::stop_token token)
+                : function {std::forward<F>(function)}
+                , token {std::move(token)}
+            {
+            }
+
+            template <typename Setter>
+            void settle(Setter setter)
+            {
+                if (!settled.exchange(true, std::memory_order_acq_rel))
+                    setter();
+            }
+
+            void run()
+            {
+                try
+                {
+                    if constexpr (std::is_void_v<ResultT>)
+                    {
+                        invoke();
+                        settle([this] { promise.set_value(); });
+                    }
+                    else
+                    {
+                        ResultT result = invoke();
+                        settle([&] { promise.set_value(std::move(result)); });
+                    }
+                }
+                catch (...)
+                {
+                    settle([this] { promise.set_exception(std::current_exception()); });
+                }
+            }
+
+            ResultT invoke()
+            {
+                if constexpr (takes_stop_token<Function>)
+                    return function(token);
+                else
+                    return function();
+            }
+
+            Function function;
+            std::stop_token token;
+            std::promise<ResultT> promise;
+            std::atomic<bool> settled {false};
+            std::optional<std::stop_callback<OnStop>> on_stop; // registered last - it may fire at once
+        };
+    }
+
+    // aggregate result of ThreadPool::submit_bulk()
+    template <typename T>
+    class BatchFuture
+    {
+    public:
+        BatchFuture() = default;
+
+        explicit BatchFuture(std::shared_ptr<detail::BatchState<T>> state)
+            : state_ {std::move(state)}
+        {
+        }
+
+        bool valid() const
+        {
+            return state_ != nullptr;
+        }
+
+        size_t size() const
+        {
+            return state_->errors.size();
+        }
+
+        void wait() const
+        {
+            state_->completed.wait();
+        }
+
+        template <typename Rep, typename Period>
+        std::future_status wait_for(const std::chrono::duration<Rep, Period>& timeout) const
+        {
+            return state_->completed.wait_for(timeout);
+        }
+
+        // result of the item at index; rethrows the exception thrown by that item
+        decltype(auto) get(size_t index) const
+        {
+            wait();
+
+            if (state_->errors[index])
+                std::rethrow_exception(state_->errors[index]);
+
+            if constexpr (!std::is_void_v<T>)
+                return static_cast<const T&>(*state_->values[index]);
+        }
+
+        // all results in input order; rethrows the exception of the first failed item
+        auto get()
+        {
+            wait();
+
+            auto state = std::move(state_);
+
+            for (const auto& eptr : state->errors)
+                if (eptr)
+                    std::rethrow_exception(eptr);
+
+            if constexpr (!std::is_void_v<T>)
+            {
+                std::vector<T> results;
+                results.reserve(state->values.size());
+                for (auto& value : state->values)
+                    results.push_back(std::move(*value));
+                return results;
+            }
+        }
+
+    private:
+        std::shared_ptr<detail::BatchState<T>> state_;
+    };
+
+    enum class WorkerPlacement
+    {
+        none,    // workers float across cpus
+        compact, // fill SMT siblings and cores sharing caches first
+        scatter, // spread workers across packages, L3 domains and cores
+        cpu_list // pin workers to ThreadPoolOptions::cpus (round-robin)
+    };
+
+    // what submit() does when max_queued tasks are already waiting
+    enum class OverflowPolicy
+    {
+        block,       // wait until there is room
+        reject,      // throw TaskRejected
+        caller_runs, // run the task in the submitting thread
+        drop_oldest  // discard the oldest queued task (its future reports broken_promise); internal tasks are kept
+    };
+
+    struct ThreadPoolOptions
+    {
+        size_t min_threads = 1;
+        size_t max_threads = std::max(1u, std::thread::hardware_concurrency());
+        std::chrono::milliseconds spawn_threshold {10}; // queue wait that triggers a new worker
+        std::chrono::milliseconds keep_alive {5000};    // idle time after which a worker above min_threads retires
+        size_t max_compensating_threads = max_threads;  // extra workers started for tasks in a BlockingSection
+        WorkerPlacement placement = WorkerPlacement::none;
+        std::vector<int> cpus {};
+        size_t max_queued = 0; // bound of the queue for tasks submitted from outside of the pool; 0 - unbounded
+        OverflowPolicy overflow = OverflowPolicy::block;
+        std::chrono::milliseconds codel_target {0};     // CoDel shedding: acceptable queue wait; 0 - off
+        std::chrono::milliseconds codel_interval {100}; // how long the wait may stay above the target
+        size_t affinity_max_backlog = 64; // hinted tasks a worker may hold; beyond that new hints are not honoured
+        std::chrono::microseconds affinity_max_wait {500}; // then any idle worker may run a hinted task
+    };
+
+    class ThreadPool
+    {
+    public:
+        explicit ThreadPool(size_t size)
+            : ThreadPool {ThreadPoolOptions {size, size}}
+        {
+        }
+
+        explicit ThreadPool(const ThreadPoolOptions& options)
+            : options_ {options}
+            , workers_(options.max_threads + options.max_compensating_threads)
+        {
+            if (options_.min_threads > options_.max_threads || options_.max_threads == 0)
+                throw std::invalid_argument("Invalid thread pool bounds");
+
+            place_workers();
+
+            std::lock_guard lk {mtx_tasks_};
+            for (size_t i = 0; i < options_.min_threads; ++i)
+                spawn_worker();
+        }
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        ~ThreadPool()
+        {
+            timers_.reset(); // no more tasks from timers
+            watcher_.reset(); // nor from futures becoming ready
+
+            {
+                std::lock_guard lk {mtx_tasks_};
+                end_work_ = true;
+                unpark_workers(parked_.size());
+            }
+            cv_space_.notify_all();
+
+            for (auto& worker : workers_)
+                if (worker.thd.joinable())
+                    worker.thd.join();
+        }
+
+        template <typename Callable>
+        auto submit(Callable&& callable)
+        {
+            return submit(TaskOptions {}, std::forward<Callable>(callable));
+        }
+
+        template <typename Callable>
+        auto submit(const TaskOptions& options, Callable&& callable) -> std::future<decltype(callable())>
+        {
+            using ResultT = decltype(callable());
+
+            auto pt = std::make_shared<std::packaged_task<ResultT()>>(std::forward<Callable>(callable));
+            std::future<ResultT> fresult = pt->get_future();
+
+            const auto deadline = options.deadline.value_or(Clock::time_point::max());
+
+            Task task = [this, pt, deadline] {
+                (*pt)();
+
+                if (Clock::now() > deadline)
+                    deadline_misses_.fetch_add(1, std::memory_order_relaxed);
+            };
+
+            push_task(make_queued_task(options, std::move(task), deadline, next_seq_++, Clock::now()));
+
+            return fresult;
+        }
+
+        // cancellable submission - the callable may take the std::stop_token as its first parameter and poll it;
+        // once stop is requested the future reports TaskCancelled at once (a result computed later is discarded)
+        // and a task still waiting in a queue is discarded without running
+        template <typename Callable>
+        auto submit(std::stop_token stop_token, Callable&& callable)
+        {
+            return submit(std::move(stop_token), TaskOptions {}, std::forward<Callable>(callable));
+        }
+
+        template <typename Callable>
+        auto submit(std::stop_token stop_token, const TaskOptions& options, Callable&& callable)
+        {
+            using StateT = detail::CancellableState<std::decay_t<Callable>>;
+
+            auto state = std::make_shared<StateT>(std::forward<Callable>(callable), std::move(stop_token));
+            auto fresult = state->promise.get_future();
+            state->on_stop.emplace(state->token, typename StateT::OnStop {state.get()});
+
+            detail::QueuedTask queued = make_posted_task(options, [this, state] {
+                if (state->token.stop_requested())
+                {
+                    cancelled_.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+
+                state->run();
+            });
+            queued.stop_token = state->token; // a full queue purges it once cancelled (see admit())
+            push_task(std::move(queued));
+
+            return fresult;
+        }
+
+        // runs fn(item) for every item in [first, last); the range must stay valid until the batch completes
+        // and fn may be called concurrently; items are enqueued in a few chunks within one critical section
+        template <typename InputIt, typename Function>
+        auto submit_bulk(InputIt first, InputIt last, Function fn, const TaskOptions& options = {})
+            -> BatchFuture<std::invoke_result_t<Function&, typename std::iterator_traits<InputIt>::reference>>
+        {
+            using ResultT = std::invoke_result_t<Function&, typename std::iterator_traits<InputIt>::reference>;
+
+            const size_t count = std::distance(first, last);
+            auto state = std::make_shared<detail::BatchState<ResultT>>(count);
+
+            if (count == 0)
+            {
+                state->done.set_value();
+                return BatchFuture<ResultT> {state};
+            }
+
+            const size_t chunk_count = std::min(count, workers_.size() * bulk_chunks_per_worker);
+            state->pending_chunks = chunk_count;
+
+            auto shared_fn = std::make_shared<Function>(std::move(fn));
+            const auto deadline = options.deadline.value_or(Clock::time_point::max());
+            const auto now = Clock::now();
+            const uint64_t first_seq = next_seq_.fetch_add(chunk_count);
+
+            std::vector<detail::QueuedTask> tasks;
+            tasks.reserve(chunk_count);
+
+            InputIt chunk_first = first;
+            for (size_t chunk = 0, offset = 0; chunk < chunk_count; ++chunk)
+            {
+                const size_t chunk_size = count / chunk_count + (chunk < count % chunk_count ? 1 : 0);
+                InputIt chunk_last = std::next(chunk_first, chunk_size);
+
+                auto guard = std::make_shared<detail::BatchChunk<ResultT>>(state, offset, offset + chunk_size);
+
+                Task task = [this, guard, shared_fn, chunk_first, chunk_last, deadline] {
+                    guard->started = true;
+
+                    auto& state = guard->state;
+                    size_t index = guard->first;
+                    for (auto it = chunk_first; it != chunk_last; ++it, ++index)
+                        state->run_item(index, *shared_fn, *it);
+
+                    if (state->finish_chunk())
+                    {
+                        if (Clock::now() > deadline)
+                            deadline_misses_.fetch_add(1, std::memory_order_relaxed);
+                        state->done.set_value();
+                    }
+                };
+
+                tasks.push_back(make_queued_task(options, std::move(task), deadline, first_seq + chunk, now));
+
+                offset += chunk_size;
+                chunk_first = chunk_last;
+            }
+
+            push_tasks(tasks.data(), tasks.size());
+
+            return BatchFuture<ResultT> {state};
+        }
+
+        // fire-and-forget submission - no future and no packaged_task; the task must not throw
+        void post(Task task)
+        {
+            post(TaskOptions {}, std::move(task));
+        }
+
+        void post(const TaskOptions& options, Task task)
+        {
+            push_task(make_posted_task(options, std::move(task)));
+        }
+
+        // runs fn on the pool once after the delay; fn must not throw
+        TimerHandle schedule_after(Clock::duration delay, Task fn)
+        {
+            return timers().schedule_after(delay, std::move(fn));
+        }
+
+        // runs fn on the pool every period; fn must not throw
+        TimerHandle schedule_every(Clock::duration period, Task fn)
+        {
+            return timers().schedule_every(period, std::move(fn));
+        }
+
+        // co_await pool.schedule() - resumes the awaiting coroutine on a worker of this pool;
+        // like every resumption of a running coroutine it skips admission control (see dispatch())
+        auto schedule(const TaskOptions& options = {})
+        {
+            return ScheduleAwaiter {*this, options, false};
+        }
+
+        // co_await pool.schedule_admitted() - schedule() for starting a new coroutine (see spawn()): from outside
+        // of the pool the resumption is admitted as submit() is - with the reject policy the co_await throws
+        // TaskRejected, block waits for room, caller_runs resumes the coroutine at once; once queued, it is never dropped
+        auto schedule_admitted(const TaskOptions& options = {})
+        {
+            return ScheduleAwaiter {*this, options, true};
+        }
+
+        // co_await pool.when_ready(std::move(future)) - resumes the coroutine on a worker when the future is ready;
+        // no worker is held meanwhile - the pool's watcher thread polls the future (see FutureWatcher)
+        template <typename Future>
+        auto when_ready(Future future)
+        {
+            struct FutureAwaiter
+            {
+                ThreadPool& pool;
+                Future future;
+
+                bool await_ready() const
+                {
+                    return future.wait_for(std::chrono::seconds::zero()) == std::future_status::ready;
+                }
+
+                void await_suspend(std::coroutine_handle<> handle)
+                {
+                    pool.watcher().watch(
+                        [this] { return future.wait_for(std::chrono::seconds::zero()) == std::future_status::ready; },
+                        [handle] { handle.resume(); });
+                }
+
+                auto await_resume()
+                {
+                    return future.get();
+                }
+            };
+
+            return FutureAwaiter {*this, std::move(future)};
+        }
+
+        // waits for a future (std::future, std::shared_future, BatchFuture); called from a worker of this pool
+        // it runs queued tasks meanwhile - the worker's own tasks first, as they include what it is waiting for -
+        // so nested waits can neither deadlock the pool nor leave the worker idle
+        template <typename Future>
+        void wait(const Future& future)
+        {
+            if (current_.pool != this)
+            {
+                future.wait();
+                return;
+            }
+
+            while (future.wait_for(std::chrono::seconds::zero()) != std::future_status::ready)
+            {
+                if (std::optional<detail::QueuedTask> task = pop_task(current_.index, true))
+                    execute(current_.index, *task);
+                else // the awaited task runs elsewhere - look for new work now and then
+                    future.wait_for(helping_wait_interval);
+            }
+        }
+
+        template <typename Future>
+        auto get(Future&& future)
+        {
+            wait(future);
+            return future.get();
+        }
+
+        // current number of worker threads
+        size_t size() const
+        {
+            std::lock_guard lk {mtx_tasks_};
+            return thread_count_;
+        }
+
+        // cpu assigned to each worker slot (-1 - not pinned)
+        std::vector<int> worker_cpus() const
+        {
+            std::vector<int> cpus;
+            for (const auto& worker : workers_)
+                cpus.push_back(worker.cpu);
+            return cpus;
+        }
+
+        // number of tasks with a deadline that completed after it
+        size_t deadline_misses() const
+        {
+            return deadline_misses_.load(std::memory_order_relaxed);
+        }
+
+        // cumulative counters aggregated over all worker slots; cheap enough to be polled by an exporter
+        ThreadPoolMetrics metrics() const
+        {
+            ThreadPoolMetrics snapshot;
+
+            {
+                std::lock_guard lk {mtx_tasks_};
+                snapshot.threads = thread_count_;
+            }
+
+            snapshot.taken_at = Clock::now();
+            snapshot.uptime = snapshot.taken_at - created_at_;
+            snapshot.queued = queued_.load() + hinted_queued_.load();
+            snapshot.tasks_submitted = next_seq_.load();
+            snapshot.tasks_rejected = rejected_.load(std::memory_order_relaxed);
+            snapshot.tasks_dropped = dropped_.load(std::memory_order_relaxed);
+            snapshot.tasks_cancelled = cancelled_.load(std::memory_order_relaxed);
+            snapshot.pin_failures = pin_failures_.load(std::memory_order_relaxed);
+            snapshot.workers.resize(workers_.size());
+
+            for (size_t i = 0; i < workers_.size(); ++i)
+            {
+                WorkerMetrics& worker = snapshot.workers[i];
+                workers_[i].counters.collect(snapshot, worker);
+
+                if (snapshot.uptime > Clock::duration::zero())
+                    worker.busy_ratio = std::chrono::duration<double>(worker.busy_time) / snapshot.uptime;
+
+                snapshot.tasks_executed += worker.tasks_executed;
+                snapshot.tasks_stolen += worker.tasks_stolen;
+            }
+
+            return snapshot;
+        }
+
+        // Chrome trace JSON of the tasks executed so far (one track per worker slot) - open it in chrome://tracing
+        // or ui.perfetto.dev; without THREAD_POOL_TRACING the trace is empty and nothing is recorded
+        void write_trace(std::ostream& out) const
+        {
+#ifdef THREAD_POOL_TRACING
+            std::vector<const TraceBuffer*> buffers;
+            for (const auto& worker : workers_)
+                buffers.push_back(&worker.trace);
+
+            write_chrome_trace(out, buffers, created_at_);
+#else
+            out << "{\"traceEvents\":[]}\n";
+#endif
+        }
+
+    private:
+        friend class BlockingSection;
+        friend class Strand;
+
+        struct Worker
+        {
+            std::thread thd;
+            bool active = false; // guarded by mtx_tasks_
+            int cpu = -1;
+            std::vector<size_t> victims; // other workers - the closest in the cache hierarchy first
+            size_t l3_group = 0;         // equal for workers pinned to cpus sharing an L3 cache
+            std::mutex mtx_local;
+            std::array<detail::TaskHeap, 3> local_tasks; // tasks submitted by this worker, by TaskAffinity
+            std::mutex mtx_park;
+            std::condition_variable cv_park;
+            bool unparked = false; // guarded by mtx_park
+            detail::WorkerCounters counters;
+#ifdef THREAD_POOL_TRACING
+            TraceBuffer trace; // written only by the thread occupying the slot
+#endif
+        };
+
+        static constexpr size_t bulk_chunks_per_worker = 4;
+        static constexpr std::chrono::microseconds helping_wait_interval {100};
+        static constexpr size_t spin_iterations = 64;
+
+        static inline thread_local detail::WorkerContext current_ {};
+
+        // the timer thread starts with the first scheduled timer
+        TimerService& timers()
+        {
+            std::call_once(timers_started_, [this] {
+                timers_ = std::make_unique<TimerService>([this](Task task) { dispatch(std::move(task)); });
+            });
+
+            return *timers_;
+        }
+
+        // the watcher thread starts with the first when_ready() that has to suspend
+        FutureWatcher& watcher()
+        {
+            std::call_once(watcher_started_, [this] {
+                watcher_ = std::make_unique<FutureWatcher>([this](Task task) { dispatch(std::move(task)); });
+            });
+
+            return *watcher_;
+        }
+
+        void place_workers()
+        {
+            // sysfs is read only when a placement needs it - floating workers are all equally far apart
+            const CpuTopology topology = (options_.placement == WorkerPlacement::none)
+                ? CpuTopology {std::vector<CpuTopology::Cpu> {}}
+                : CpuTopology::detect();
+            std::vector<int> order;
+
+            switch (options_.placement)
+            {
+            case WorkerPlacement::none:
+                break;
+            case WorkerPlacement::compact:
+                order = topology.compact_order();
+                break;
+            case WorkerPlacement::scatter:
+                order = topology.scatter_order();
+                break;
+            case WorkerPlacement::cpu_list:
+                order = options_.cpus;
+                if (order.empty() || !std::all_of(order.begin(), order.end(), [&topology](int cpu) { return topology.contains(cpu); }))
+                    throw std::invalid_argument("Invalid cpu list for worker placement");
+                break;
+            }
+
+            for (size_t i = 0; i < workers_.size(); ++i)
+                workers_[i].cpu = order.empty() ? -1 : order[i % order.size()];
+
+            const size_t count = workers_.size();
+            for (size_t i = 0; i < count; ++i)
+            {
+                auto& victims = workers_[i].victims;
+                for (size_t offset = 1; offset < count; ++offset)
+                    victims.push_back((i + offset) % count);
+
+                std::stable_sort(victims.begin(), victims.end(), [&](size_t a, size_t b) {
+                    return topology.distance(workers_[i].cpu, workers_[a].cpu) < topology.distance(workers_[i].cpu, workers_[b].cpu);
+                });
+
+                workers_[i].l3_group = i;
+                for (size_t j = 0; j < i; ++j)
+                {
+                    if (workers_[i].cpu >= 0 && workers_[j].cpu >= 0 && topology.distance(workers_[i].cpu, workers_[j].cpu) <= 2)
+                    {
+                        workers_[i].l3_group = workers_[j].l3_group;
+                        break;
+                    }
+                }
+            }
+        }
+
+        void spawn_worker()
+        {
+            auto slot = std::find_if(workers_.begin(), workers_.end(), [](const Worker& w) { return !w.active; });
+            assert(slot != workers_.end());
+
+            if (slot->thd.joinable()) // retired worker - it has already left run()
+                slot->thd.join();
+
+            slot->active = true;
+            idle_count_.fetch_add(1); // a starting worker is about to look for work - do not spawn another one for it
+            slot->thd = std::thread {&ThreadPool::run, this, static_cast<size_t>(slot - workers_.begin())};
+            ++thread_count_;
+
+            // a worker that cannot be pinned runs unpinned; its victims and L3 group stay as placed
+            if (slot->cpu >= 0 && !pin_thread(slot->thd, slot->cpu))
+                pin_failures_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // a worker is about to block - keep the number of runnable workers by starting a compensating one
+        void enter_blocking()
+        {
+            const size_t released = (current_.pool == this) ? release_hinted_tasks(current_.index) : 0;
+
+            std::lock_guard lk {mtx_tasks_};
+
+            unpark_workers(released);
+
+            ++blocked_count_;
+
+            const bool slot_free = std::any_of(workers_.begin(), workers_.end(), [](const Worker& w) { return !w.active; });
+            if (!end_work_ && thread_count_ - blocked_count_ < options_.max_threads && slot_free)
+                spawn_worker();
+        }
+
+        void exit_blocking()
+        {
+            std::lock_guard lk {mtx_tasks_};
+
+            --blocked_count_;
+
+            // the compensating worker is no longer needed - the first worker that finds itself idle retires
+            if (thread_count_ > options_.max_threads + blocked_count_ + retire_requests_)
+                retire_requests_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        // hinted tasks of a worker that is about to block would wait for it - any worker may run them now
+        size_t release_hinted_tasks(size_t index)
+        {
+            Worker& worker = workers_[index];
+            std::lock_guard lk {worker.mtx_local};
+
+            size_t released = 0;
+            for (auto affinity : {TaskAffinity::same_l3, TaskAffinity::same_worker})
+            {
+                auto& tasks = worker.local_tasks[static_cast<size_t>(affinity)];
+                for (; !tasks.empty(); ++released)
+                    worker.local_tasks[static_cast<size_t>(TaskAffinity::any)].push(tasks.pop());
+            }
+
+            queued_.fetch_add(released);
+            hinted_queued_.fetch_sub(released);
+
+            return released;
+        }
+
+        bool local_queue_empty(size_t index)
+        {
+            std::lock_guard lk {workers_[index].mtx_local};
+            const auto& heaps = workers_[index].local_tasks;
+            return std::all_of(heaps.begin(), heaps.end(), [](const detail::TaskHeap& tasks) { return tasks.empty(); });
+        }
+
+        // may the worker run a task with the affinity submitted by origin
+        bool may_run(TaskAffinity affinity, size_t origin, size_t worker) const
+        {
+            switch (affinity)
+            {
+            case TaskAffinity::same_l3:
+                return workers_[origin].l3_group == workers_[worker].l3_group;
+            case TaskAffinity::same_worker:
+                return origin == worker;
+            default:
+                return true;
+            }
+        }
+
+        // called by a worker between tasks, under mtx_tasks_; its local queue must be empty
+        bool try_retire(size_t index)
+        {
+            if (retire_requests_.load(std::memory_order_relaxed) == 0 || thread_count_ <= options_.min_threads)
+                return false;
+
+            retire_requests_.fetch_sub(1, std::memory_order_relaxed);
+            workers_[index].active = false;
+            --thread_count_;
+            return true;
+        }
+
+        void try_grow(Clock::time_point now)
+        {
+            // spawn_threshold is also the cool-down between spawns, so a burst adds workers one by one
+            if (end_work_ || thread_count_ >= options_.max_threads
+                || (thread_count_ > 0 && now - last_spawn_ < options_.spawn_threshold))
+                return;
+
+            last_spawn_ = now;
+            spawn_worker();
+        }
+
+        // the check pop_global() makes for the global queue, for the local ones: a task has waited for
+        // spawn_threshold, more are waiting and no worker is idle - every worker is busy
+        void grow_if_backlogged(Clock::time_point enqueued_at)
+        {
+            if (idle_count_.load() > 0 || queued_.load() == 0 || thread_count_.load() >= options_.max_threads)
+                return;
+
+            const auto now = Clock::now();
+            if (now - enqueued_at < options_.spawn_threshold)
+                return;
+
+            std::lock_guard lk {mtx_tasks_};
+            try_grow(now);
+        }
+
+        static detail::QueuedTask make_queued_task(const TaskOptions& options, Task task, Clock::time_point deadline,
+            uint64_t seq, Clock::time_point now)
+        {
+#ifdef THREAD_POOL_TRACING
+            return detail::QueuedTask {std::move(task), options.priority, deadline, seq, now, options.affinity, detail::no_worker, options.name};
+#else
+            return detail::QueuedTask {std::move(task), options.priority, deadline, seq, now, options.affinity};
+#endif
+        }
+
+        void execute(size_t index, detail::QueuedTask& task)
+        {
+            Worker& worker = workers_[index];
+
+            const auto started_at = Clock::now();
+            ++worker.counters.depth;
+            task.task();
+            --worker.counters.depth;
+            const auto finished_at = Clock::now();
+
+            worker.counters.record(started_at - task.enqueued_at, finished_at - started_at, worker.counters.depth > 0);
+            if (task.affinity != TaskAffinity::any && task.origin != detail::no_worker)
+                worker.counters.record_affinity(may_run(task.affinity, task.origin, index));
+#ifdef THREAD_POOL_TRACING
+            worker.trace.record(TraceEvent {task.name, task.enqueued_at, started_at, finished_at});
+#endif
+        }
+
+        detail::QueuedTask make_posted_task(const TaskOptions& options, Task task)
+        {
+            if (!task)
+                throw std::invalid_argument("Empty function is not supported");
+
+            const auto deadline = options.deadline.value_or(Clock::time_point::max());
+
+            if (options.deadline)
+            {
+                task = [this, task = std::move(task), deadline] {
+                    task();
+
+                    if (Clock::now() > deadline)
+                        deadline_misses_.fetch_add(1, std::memory_order_relaxed);
+                };
+            }
+
+            return make_queued_task(options, std::move(task), deadline, next_seq_++, Clock::now());
+        }
+
+        struct ScheduleAwaiter
+        {
+            ThreadPool& pool;
+            TaskOptions options;
+            bool admission;
+
+            bool await_ready() const noexcept
+            {
+                return false;
+            }
+
+            // with caller_runs the coroutine is resumed inside push_task() - the awaiter may be gone when it returns
+            void await_suspend(std::coroutine_handle<> handle)
+            {
+                detail::QueuedTask queued = pool.make_posted_task(options, [handle] { handle.resume(); });
+                queued.droppable = false; // a dropped resumption would leak the frame
+                pool.push_task(std::move(queued), admission);
+            }
+
+            void await_resume() const noexcept
+            {
+            }
+        };
+
+        // post() for tasks the pool relies on - strand drains, timer callbacks, coroutine resumptions: they must not
+        // be lost, run inline or block the thread that hands them over, so they skip admission control
+        // and are never dropped by drop_oldest or CoDel
+        void dispatch(Task task, const TaskOptions& options = {})
+        {
+            detail::QueuedTask queued = make_posted_task(options, std::move(task));
+            queued.droppable = false;
+            push_task(std::move(queued), false);
+        }
+
+        void push_task(detail::QueuedTask&& task, bool admission = true)
+        {
+            push_tasks(&task, 1, admission);
+        }
+
+        // tasks submitted by workers always get in - blocking or rejecting them could deadlock the pool
+        // or break a computation that has already been admitted
+        void push_tasks(detail::QueuedTask* tasks, size_t count, bool admission = true)
+        {
+            if (current_.pool == this) // submitted by one of our workers - keep it close to the parent
+            {
+                Worker& worker = workers_[current_.index];
+                size_t stealable = 0;
+                bool first_hinted = false;
+                std::optional<Clock::time_point> oldest_stealable;
+                {
+                    std::lock_guard lk {worker.mtx_local};
+                    for (size_t i = 0; i < count; ++i)
+                    {
+                        tasks[i].origin = current_.index;
+
+                        auto queue = tasks[i].affinity;
+                        if (queue != TaskAffinity::any && hinted_backlog(worker) >= options_.affinity_max_backlog)
+                            queue = TaskAffinity::any; // the worker is overloaded - let others help
+
+                        // counted before the push - poppers never see a counter go below zero
+                        if (queue == TaskAffinity::any)
+                        {
+                            queued_.fetch_add(1);
+                            ++stealable;
+                        }
+                        else if (hinted_queued_.fetch_add(1) == 0)
+                            first_hinted = true;
+
+                        worker.local_tasks[static_cast<size_t>(queue)].push(std::move(tasks[i]));
+                    }
+
+                    const auto& local = worker.local_tasks[static_cast<size_t>(TaskAffinity::any)];
+                    if (stealable > 0)
+                        oldest_stealable = local.top().enqueued_at; // FIFO within a priority class
+                }
+
+                // hinted tasks wait for their worker, which is running right now - one idle worker wakes up only
+                // to watch them (see park()), in case the worker does not get to them in time
+                const size_t wake = stealable + ((first_hinted && !hint_watcher_.load()) ? 1 : 0);
+                if (wake > 0 && idle_count_.load() > 0) // pairs with the idle_count_/queued_ check in park()
+                {
+                    std::lock_guard lk {mtx_tasks_};
+                    unpark_workers(wake);
+                }
+                else if (oldest_stealable) // the worker's backlog may have waited for too long already
+                    grow_if_backlogged(*oldest_stealable);
+
+                return;
+            }
+
+            std::vector<detail::QueuedTask> dropped; // destroyed after the lock is released
+            {
+                std::unique_lock lk {mtx_tasks_};
+                const auto now = tasks[0].enqueued_at;
+
+                if (admission && options_.max_queued > 0 && !admit(lk, tasks, count, dropped))
+                    return;
+
+                queued_.fetch_add(count);
+
+                if (q_tasks_.empty())
+                    last_dequeue_ = now; // the queue starts a new backlog period
+                for (size_t i = 0; i < count; ++i)
+                    q_tasks_.push(std::move(tasks[i]));
+                global_size_.store(q_tasks_.size(), std::memory_order_relaxed);
+
+                // nobody has taken a task from the queue for too long - every worker is busy
+                if (thread_count_ == 0 || (idle_count_.load() == 0 && now - last_dequeue_ >= options_.spawn_threshold))
+                    try_grow(now);
+
+                unpark_workers(count);
+            }
+        }
+
+        // applies the overflow policy when the global queue is full; false - the tasks must not be queued
+        // (they were run by the caller); called under mtx_tasks_
+        bool admit(std::unique_lock<std::mutex>& lk, detail::QueuedTask* tasks, size_t count, std::vector<detail::QueuedTask>& dropped)
+        {
+            // a batch larger than the whole queue is admitted into an empty one
+            const auto has_room = [this, count] { return q_tasks_.empty() || q_tasks_.size() + count <= options_.max_queued; };
+
+            if (has_room())
+                return true;
+
+            // cancelled tasks hold no room - they would be discarded without running anyway
+            purge_cancelled(dropped);
+            if (has_room())
+                return true;
+
+            switch (options_.overflow)
+            {
+            case OverflowPolicy::block:
+                ++space_waiters_;
+                cv_space_.wait(lk, [&] {
+                    purge_cancelled(dropped);
+                    return end_work_ || has_room();
+                });
+                --space_waiters_;
+                return true;
+
+            case OverflowPolicy::reject:
+                rejected_.fetch_add(count, std::memory_order_relaxed);
+                throw TaskRejected {"Thread pool queue is full"};
+
+            case OverflowPolicy::caller_runs:
+                lk.unlock();
+                for (size_t i = 0; i < count; ++i)
+                    tasks[i].task();
+                return false;
+
+            case OverflowPolicy::drop_oldest:
+            {
+                const size_t purged = dropped.size();
+                while (!has_room()) // a queue full of tasks that may not be dropped takes the new ones beyond its bound
+                {
+                    std::optional<detail::QueuedTask> oldest = q_tasks_.pop_oldest_droppable();
+                    if (!oldest)
+                        break;
+
+                    queued_.fetch_sub(1);
+                    dropped.push_back(std::move(*oldest));
+                }
+                global_size_.store(q_tasks_.size(), std::memory_order_relaxed);
+                dropped_.fetch_add(dropped.size() - purged, std::memory_order_relaxed);
+                return true;
+            }
+            }
+
+            return true;
+        }
+
+        // takes the cancelled tasks out of the global queue, so they no longer count against max_queued;
+        // O(n) - done only when the queue is full; called under mtx_tasks_
+        void purge_cancelled(std::vector<detail::QueuedTask>& purged)
+        {
+            const size_t count = q_tasks_.purge_cancelled(purged);
+            if (count == 0)
+                return;
+
+            queued_.fetch_sub(count);
+            global_size_.store(q_tasks_.size(), std::memory_order_relaxed);
+            cancelled_.fetch_add(count, std::memory_order_relaxed);
+        }
+
+        // wakes one parked worker per new task, minus the workers spinning for work, which will take some of them;
+        // every worker sleeps on its own condition variable, so nobody else wakes up; called under mtx_tasks_
+        void unpark_workers(size_t count)
+        {
+            if (!end_work_)
+                count -= std::min(count, spinning_.load());
+
+            for (; count > 0 && !parked_.empty(); --count)
+            {
+                Worker& worker = workers_[parked_.back()]; // the most recently parked one - its caches are still warm
+                parked_.pop_back();
+
+                {
+                    std::lock_guard lk {worker.mtx_park};
+                    worker.unparked = true;
+                }
+                worker.cv_park.notify_one();
+            }
+        }
+
+        // a worker that ran out of work watches the task counter for a moment before it parks,
+        // so a burst is picked up without a sleep/wake round trip; returns true if work has arrived
+        bool spin()
+        {
+            spinning_.fetch_add(1);
+
+            bool has_work = false;
+            for (size_t i = 0; i < spin_iterations && !has_work; ++i)
+            {
+                has_work = queued_.load() > 0;
+                if (!has_work)
+                    std::this_thread::yield();
+            }
+
+            spinning_.fetch_sub(1);
+
+            return has_work;
+        }
+
+        // sleeps until a submitter unparks the worker or the keep-alive period ends; while hinted tasks wait
+        // for their workers, one parked worker - the watcher - sleeps only until the oldest of them may be stolen;
+        // returns false on timeout with no work in sight; called under mtx_tasks_, returns under it
+        // unless unparked - a woken worker goes back to its queues without taking mtx_tasks_ again
+        bool park(std::unique_lock<std::mutex>& lk, size_t index)
+        {
+            Worker& self = workers_[index];
+
+            idle_count_.fetch_add(1);
+            if (end_work_ || queued_.load() > 0) // pairs with the idle_count_ check after a push
+            {
+                idle_count_.fetch_sub(1);
+                return true;
+            }
+
+            const bool watching_hints = hinted_queued_.load() > 0 && !hint_watcher_.exchange(true);
+
+            {
+                std::lock_guard park_lk {self.mtx_park};
+                self.unparked = false;
+            }
+            parked_.push_back(index);
+
+            lk.unlock();
+
+            bool unparked;
+            {
+                std::unique_lock park_lk {self.mtx_park};
+                const Clock::duration timeout = watching_hints ? Clock::duration {options_.affinity_max_wait}
+                                                               : Clock::duration {options_.keep_alive};
+                unparked = self.cv_park.wait_until(park_lk, Clock::now() + timeout, [&self] { return self.unparked; });
+            }
+
+            if (unparked && !watching_hints) // unpark_workers() has taken it off parked_ already
+            {
+                idle_count_.fetch_sub(1);
+                return true;
+            }
+
+            lk.lock();
+
+            if (!unparked)
+            {
+                auto it = std::find(parked_.begin(), parked_.end(), index);
+                if (it != parked_.end())
+                    parked_.erase(it);
+                else
+                    unparked = true; // unparked right after the timeout
+            }
+
+            idle_count_.fetch_sub(1);
+
+            if (watching_hints)
+            {
+                hint_watcher_.store(false);
+                if (unparked && hinted_queued_.load() > 0) // off to other work - hand the watch over
+                    unpark_workers(1);
+            }
+
+            return unparked || end_work_ || queued_.load() > 0 || watching_hints;
+        }
+
+        std::optional<detail::QueuedTask> take(detail::TaskHeap& tasks)
+        {
+            queued_.fetch_sub(1);
+            return tasks.pop();
+        }
+
+        std::optional<detail::QueuedTask> take_local(Worker& worker, size_t queue)
+        {
+            if (queue == static_cast<size_t>(TaskAffinity::any))
+                return take(worker.local_tasks[queue]);
+
+            hinted_queued_.fetch_sub(1);
+            return worker.local_tasks[queue].pop();
+        }
+
+        static size_t hinted_backlog(const Worker& worker)
+        {
+            return worker.local_tasks[static_cast<size_t>(TaskAffinity::same_l3)].size()
+                + worker.local_tasks[static_cast<size_t>(TaskAffinity::same_worker)].size();
+        }
+
+        // the local queue of owner holding the most urgent task that worker may run - a hinted task also once it
+        // has waited for affinity_max_wait (its worker is busy with something else); called under owner's mtx_local
+        std::optional<size_t> runnable_queue(size_t owner, size_t worker)
+        {
+            const auto& heaps = workers_[owner].local_tasks;
+            std::optional<size_t> best;
+            std::optional<Clock::time_point> now;
+
+            const auto overdue = [&](const detail::QueuedTask& task) {
+                if (!now)
+                    now = Clock::now();
+                return *now - task.enqueued_at >= options_.affinity_max_wait;
+            };
+
+            for (size_t queue = 0; queue < heaps.size(); ++queue)
+            {
+                if (heaps[queue].empty())
+                    continue;
+
+                if (!may_run(static_cast<TaskAffinity>(queue), owner, worker) && !overdue(heaps[queue].top()))
+                    continue;
+
+                if (!best || detail::LessUrgent {}(heaps[*best].top(), heaps[queue].top()))
+                    best = queue;
+            }
+
+            return best;
+        }
+
+        bool global_more_urgent(const detail::QueuedTask& task)
+        {
+            if (global_size_.load(std::memory_order_relaxed) == 0)
+                return false;
+
+            std::lock_guard lk {mtx_tasks_};
+            return !q_tasks_.empty() && detail::LessUrgent {}(task, q_tasks_.top());
+        }
+
+        std::optional<detail::QueuedTask> pop_global()
+        {
+            if (global_size_.load(std::memory_order_relaxed) == 0)
+                return std::nullopt;
+
+            std::vector<detail::QueuedTask> dropped; // destroyed after the lock is released
+            std::lock_guard lk {mtx_tasks_};
+            if (q_tasks_.empty())
+                return std::nullopt;
+
+            const auto now = Clock::now();
+
+            auto task = take(q_tasks_);
+            if (options_.codel_target > Clock::duration::zero())
+                task = shed(std::move(*task), now, dropped);
+            global_size_.store(q_tasks_.size(), std::memory_order_relaxed);
+
+            if (space_waiters_ > 0)
+                cv_space_.notify_all();
+
+            if (!task)
+                return std::nullopt;
+
+            last_dequeue_ = now;
+            if (!q_tasks_.empty() && idle_count_.load() == 0 && now - task->enqueued_at >= options_.spawn_threshold)
+                try_grow(now);
+
+            return task;
+        }
+
+        // CoDel (RFC 8289) on the global queue: once tasks have waited longer than codel_target for a whole
+        // codel_interval, tasks are dropped at dequeue at a rate growing with the square root of the drop count,
+        // until the wait falls below the target; the queue drains and new work fails fast instead of timing out;
+        // a task that may not be dropped is returned even while dropping
+        std::optional<detail::QueuedTask> shed(detail::QueuedTask task, Clock::time_point now, std::vector<detail::QueuedTask>& dropped)
+        {
+            const size_t dropped_before = dropped.size();
+            std::optional<detail::QueuedTask> current {std::move(task)};
+
+            const auto drop_current = [&] {
+                dropped.push_back(std::move(*current));
+                current.reset();
+                if (!q_tasks_.empty())
+                    current = take(q_tasks_);
+            };
+
+            if (codel_.dropping)
+            {
+                if (!codel_ok_to_drop(*current, now))
+                    codel_.dropping = false;
+
+                while (codel_.dropping && now >= codel_.drop_next && current->droppable)
+                {
+                    drop_current();
+                    ++codel_.drop_count;
+
+                    if (current && codel_ok_to_drop(*current, now))
+                        codel_.drop_next = codel_control_law(codel_.drop_next);
+                    else
+                        codel_.dropping = false;
+                }
+            }
+            else if (current->droppable && codel_ok_to_drop(*current, now))
+            {
+                drop_current();
+
+                // dropping again soon after the last dropping period - resume near the previous drop rate
+                const bool recent = now - codel_.drop_next < 16 * options_.codel_interval;
+                codel_.drop_count = (recent && codel_.drop_count > 2) ? codel_.drop_count - 2 : 1;
+                codel_.drop_next = codel_control_law(now);
+                codel_.dropping = true;
+            }
+
+            dropped_.fetch_add(dropped.size() - dropped_before, std::memory_order_relaxed);
+
+            return current;
+        }
+
+        bool codel_ok_to_drop(const detail::QueuedTask& task, Clock::time_point now)
+        {
+            if (now - task.enqueued_at < options_.codel_target || q_tasks_.empty())
+            {
+                codel_.first_above = Clock::time_point {};
+                return false;
+            }
+
+            if (codel_.first_above == Clock::time_point {})
+            {
+                codel_.first_above = now + options_.codel_interval;
+                return false;
+            }
+
+            return now >= codel_.first_above;
+        }
+
+        Clock::time_point codel_control_law(Clock::time_point t) const
+        {
+            const auto step = std::chrono::duration<double>(options_.codel_interval) / std::sqrt(static_cast<double>(codel_.drop_count));
+            return t + std::chrono::duration_cast<Clock::duration>(step);
+        }
+
+        std::optional<detail::QueuedTask> steal(size_t index)
+        {
+            for (size_t victim : workers_[index].victims)
+            {
+                Worker& worker = workers_[victim];
+                std::unique_lock lk {worker.mtx_local};
+                if (auto queue = runnable_queue(victim, index))
+                {
+                    workers_[index].counters.record_steal();
+                    auto task = take_local(worker, *queue);
+                    lk.unlock();
+
+                    grow_if_backlogged(task->enqueued_at);
+                    return task;
+                }
+            }
+
+            return std::nullopt;
+        }
+
+        // the most urgent of the local and the global queue, otherwise a task stolen from the nearest worker;
+        // local_first - the worker waits for one of its own tasks, so it ignores more urgent global tasks
+        std::optional<detail::QueuedTask> pop_task(size_t index, bool local_first = false)
+        {
+            if (queued_.load() == 0 && hinted_queued_.load() == 0)
+                return std::nullopt;
+
+            Worker& self = workers_[index];
+            {
+                std::unique_lock lk {self.mtx_local};
+                auto queue = runnable_queue(index, index);
+                if (queue && (local_first || !global_more_urgent(self.local_tasks[*queue].top())))
+                {
+                    auto task = take_local(self, *queue);
+                    lk.unlock();
+
+                    grow_if_backlogged(task->enqueued_at);
+                    return task;
+                }
+            }
+
+            if (auto task = pop_global())
+                return task;
+
+            return steal(index);
+        }
+
+        void run(size_t index)
+        {
+            current_ = detail::WorkerContext {this, index};
+            idle_count_.fetch_sub(1); // counted as idle since spawn_worker()
+
+            while (true)
+            {
+                if (std::optional<detail::QueuedTask> task = pop_task(index))
+                {
+                    execute(index, *task);
+
+                    if (retire_requests_.load(std::memory_order_relaxed) > 0 && local_queue_empty(index))
+                    {
+                        std::lock_guard lk {mtx_tasks_};
+                        if (try_retire(index))
+                            return;
+                    }
+
+                    continue;
+                }
+
+                if (spin())
+                    continue;
+
+                std::unique_lock lk {mtx_tasks_};
+
+                const bool has_work = park(lk, index);
+
+                if (!lk.owns_lock()) // unparked for new tasks
+                    continue;
+
+                if (!has_work && thread_count_ > options_.min_threads) // idle for the whole keep-alive period
+                {
+                    workers_[index].active = false;
+                    --thread_count_;
+                    return;
+                }
+
+                if (try_retire(index)) // surplus after a BlockingSection ended
+                    return;
+
+                if (end_work_ && queued_.load() == 0) // all tasks are done
+                    return;
+            }
+        }
+
+        const ThreadPoolOptions options_;
+        mutable std::mutex mtx_tasks_;
+        detail::TaskHeap q_tasks_; // tasks submitted from outside of the pool
+        std::atomic<size_t> global_size_ {0};
+        std::atomic<size_t> queued_ {0}; // tasks any worker may run - in the global and all local queues
+        std::atomic<size_t> hinted_queued_ {0}; // tasks waiting for their worker or L3 domain
+        std::atomic<bool> hint_watcher_ {false}; // a parked worker watches hinted tasks
+        std::vector<Worker> workers_;
+        std::atomic<size_t> thread_count_ {0}; // modified under mtx_tasks_
+        size_t blocked_count_ = 0;   // workers inside a BlockingSection
+        std::atomic<size_t> retire_requests_ {0}; // surplus compensating workers; modified under mtx_tasks_
+        std::atomic<size_t> idle_count_ {0}; // parked and starting workers
+        std::atomic<size_t> spinning_ {0};
+        std::vector<size_t> parked_; // indexes of parked workers, the most recently parked last
+        Clock::time_point last_dequeue_ {};
+        Clock::time_point last_spawn_ {};
+        std::atomic<uint64_t> next_seq_ {0};
+        bool end_work_ = false;
+        std::atomic<size_t> deadline_misses_ {0};
+        std::once_flag timers_started_;
+        std::unique_ptr<TimerService> timers_;
+        std::once_flag watcher_started_;
+        std::unique_ptr<FutureWatcher> watcher_;
+        std::condition_variable cv_space_; // submitters blocked on a full queue
+        size_t space_waiters_ = 0;
+        std::atomic<uint64_t> rejected_ {0};
+        std::atomic<uint64_t> dropped_ {0};
+        std::atomic<uint64_t> cancelled_ {0};
+        std::atomic<uint64_t> pin_failures_ {0};
+        detail::CoDelState codel_; // guarded by mtx_tasks_
+        const Clock::time_point created_at_ = Clock::now();
+    };
+
+    // marks a part of a pool task that blocks (I/O, sleep, waiting on something outside of the pool);
+    // the pool starts a compensating worker for its duration, so compute throughput does not collapse;
+    // outside of a pool worker it does nothing
+    class BlockingSection
+    {
+    public:
+        BlockingSection()
+            : pool_ {ThreadPool::current_.pool}
+        {
+            if (pool_)
+                pool_->enter_blocking();
+        }
+
+        BlockingSection(const BlockingSection&) = delete;
+        BlockingSection& operator=(const BlockingSection&) = delete;
+
+        ~BlockingSection()
+        {
+            if (pool_)
+                pool_->exit_blocking();
+        }
+
+    private:
+        ThreadPool* pool_;
+    };
+}
+
+#endif // THREAD_POOL_HPP
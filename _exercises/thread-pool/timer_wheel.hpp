@@ -0,0 +1,405 @@
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ver_2_0
+{
+    namespace detail
+    {
+        struct TimerNode
+        {
+            TimerNode* prev = nullptr;
+            TimerNode* next = nullptr;
+            uint64_t expiry = 0; // tick
+            uint64_t period = 0; // ticks; 0 - one-shot timer
+            uint8_t level = 0;
+            uint8_t slot = 0;
+            std::function<void()> callback;
+            std::shared_ptr<TimerNode> self; // keeps the node alive while it is linked into the wheel
+            std::atomic<bool> cancelled {false};
+            std::atomic<bool> running {false};
+        };
+
+        // hierarchical timing wheel: 6 levels of 64 slots, every level 64 times coarser than the one below;
+        // insert and remove are O(1), timers from coarse levels cascade down as their time approaches;
+        // not thread-safe
+        class TimerWheel
+        {
+        public:
+            static constexpr unsigned bits_per_level = 6;
+            static constexpr unsigned slot_count = 1u << bits_per_level;
+            static constexpr unsigned level_count = 6;
+
+            explicit TimerWheel(uint64_t current_tick = 0)
+                : current_ {current_tick}
+            {
+            }
+
+            TimerWheel(const TimerWheel&) = delete;
+            TimerWheel& operator=(const TimerWheel&) = delete;
+
+            uint64_t current() const
+            {
+                return current_;
+            }
+
+            size_t size() const
+            {
+                return size_;
+            }
+
+            // node->expiry must be greater than current()
+            void insert(TimerNode* node)
+            {
+                const uint64_t diff = node->expiry ^ current_;
+                const unsigned level = (diff == 0) ? 0 : std::min<unsigned>((std::bit_width(diff) - 1) / bits_per_level, level_count - 1);
+
+                node->level = static_cast<uint8_t>(level);
+                node->slot = static_cast<uint8_t>((node->expiry >> (level * bits_per_level)) & (slot_count - 1));
+
+                TimerNode*& head = slots_[level][node->slot];
+                node->prev = nullptr;
+                node->next = head;
+                if (head)
+                    head->prev = node;
+                head = node;
+
+                occupied_[level] |= uint64_t {1} << node->slot;
+                ++size_;
+            }
+
+            void remove(TimerNode* node)
+            {
+                TimerNode*& head = slots_[node->level][node->slot];
+
+                if (node->prev)
+                    node->prev->next = node->next;
+                else
+                    head = node->next;
+
+                if (node->next)
+                    node->next->prev = node->prev;
+
+                if (!head)
+                    occupied_[node->level] &= ~(uint64_t {1} << node->slot);
+
+                node->prev = node->next = nullptr;
+                --size_;
+            }
+
+            // moves the wheel to the tick; expired timers are unlinked and appended to due
+            void advance(uint64_t tick, std::vector<TimerNode*>& due)
+            {
+                while (current_ < tick)
+                {
+                    if (size_ == 0)
+                    {
+                        current_ = tick;
+                        return;
+                    }
+
+                    ++current_;
+
+                    for (unsigned level = level_count - 1; level > 0; --level)
+                    {
+                        const unsigned shift = level * bits_per_level;
+                        if ((current_ & ((uint64_t {1} << shift) - 1)) == 0)
+                            cascade(level, (current_ >> shift) & (slot_count - 1));
+                    }
+
+                    for (TimerNode* node = detach(0, current_ & (slot_count - 1)); node;)
+                    {
+                        TimerNode* next = node->next;
+                        node->prev = node->next = nullptr;
+                        due.push_back(node);
+                        node = next;
+                    }
+                }
+            }
+
+            // unlinks all timers
+            void clear(std::vector<TimerNode*>& removed)
+            {
+                for (unsigned level = 0; level < level_count; ++level)
+                    for (unsigned slot = 0; slot < slot_count; ++slot)
+                        for (TimerNode* node = detach(level, slot); node; node = node->next)
+                            removed.push_back(node);
+            }
+
+            // the next tick at which advance() has something to do - an expiry or a cascade
+            std::optional<uint64_t> next_event() const
+            {
+                if (size_ == 0)
+                    return std::nullopt;
+
+                uint64_t next = std::numeric_limits<uint64_t>::max();
+
+                if (occupied_[0])
+                {
+                    const unsigned start = (current_ + 1) & (slot_count - 1);
+                    const uint64_t rotated = std::rotr(occupied_[0], static_cast<int>(start));
+                    next = current_ + 1 + std::countr_zero(rotated);
+                }
+
+                for (unsigned level = 1; level < level_count; ++level)
+                {
+                    if (occupied_[level])
+                    {
+                        const unsigned shift = level * bits_per_level;
+                        next = std::min(next, ((current_ >> shift) + 1) << shift);
+                        break;
+                    }
+                }
+
+                return next;
+            }
+
+        private:
+            TimerNode* detach(unsigned level, uint64_t slot)
+            {
+                TimerNode* head = std::exchange(slots_[level][slot], nullptr);
+                occupied_[level] &= ~(uint64_t {1} << slot);
+
+                for (TimerNode* node = head; node; node = node->next)
+                    --size_;
+
+                return head;
+            }
+
+            void cascade(unsigned level, uint64_t slot)
+            {
+                for (TimerNode* node = detach(level, slot); node;)
+                {
+                    TimerNode* next = node->next;
+                    insert(node);
+                    node = next;
+                }
+            }
+
+            uint64_t current_;
+            size_t size_ = 0;
+            TimerNode* slots_[level_count][slot_count] = {};
+            uint64_t occupied_[level_count] = {};
+        };
+
+        struct TimerCore
+        {
+            std::mutex mtx;
+            std::condition_variable cv;
+            TimerWheel wheel;
+            uint64_t next_wake = std::numeric_limits<uint64_t>::max();
+            bool stop = false;
+        };
+    }
+
+    class TimerHandle
+    {
+    public:
+        TimerHandle() = default;
+
+        TimerHandle(std::weak_ptr<detail::TimerCore> core, std::weak_ptr<detail::TimerNode> node)
+            : core_ {std::move(core)}
+            , node_ {std::move(node)}
+        {
+        }
+
+        // returns true if the call prevented the callback from running (again)
+        bool cancel()
+        {
+            auto node = node_.lock();
+            if (!node || node->cancelled.exchange(true))
+                return false;
+
+            if (auto core = core_.lock())
+            {
+                std::lock_guard lk {core->mtx};
+                if (node->self) // still in the wheel
+                {
+                    core->wheel.remove(node.get());
+                    node->self.reset();
+                    return true;
+                }
+            }
+
+            // a fired one-shot timer still waiting in the pool queue will not run
+            return node->period == 0 && !node->running.load();
+        }
+
+    private:
+        std::weak_ptr<detail::TimerCore> core_;
+        std::weak_ptr<detail::TimerNode> node_;
+    };
+
+    // one thread driving a timer wheel; due callbacks are handed to the dispatch function
+    class TimerService
+    {
+    public:
+        using Clock = std::chrono::steady_clock;
+        using Dispatch = std::function<void(std::function<void()>)>;
+
+        static constexpr std::chrono::milliseconds tick {1};
+
+        explicit TimerService(Dispatch dispatch)
+            : dispatch_ {std::move(dispatch)}
+            , start_ {Clock::now()}
+            , core_ {std::make_shared<detail::TimerCore>()}
+            , thd_ {&TimerService::run, this}
+        {
+        }
+
+        TimerService(const TimerService&) = delete;
+        TimerService& operator=(const TimerService&) = delete;
+
+        // pending timers are dropped
+        ~TimerService()
+        {
+            {
+                std::lock_guard lk {core_->mtx};
+                core_->stop = true;
+            }
+            core_->cv.notify_one();
+            thd_.join();
+
+            std::vector<detail::TimerNode*> remaining;
+            core_->wheel.clear(remaining);
+            for (auto* node : remaining)
+                node->self.reset();
+        }
+
+        TimerHandle schedule_after(Clock::duration delay, std::function<void()> callback)
+        {
+            return arm(delay, Clock::duration::zero(), std::move(callback));
+        }
+
+        // the first run is one period from now; a run is skipped while the previous one is still executing
+        TimerHandle schedule_every(Clock::duration period, std::function<void()> callback)
+        {
+            if (period < tick)
+                period = tick;
+
+            return arm(period, period, std::move(callback));
+        }
+
+        size_t pending() const
+        {
+            std::lock_guard lk {core_->mtx};
+            return core_->wheel.size();
+        }
+
+    private:
+        uint64_t ticks(Clock::duration duration) const
+        {
+            const auto count = (duration + tick - Clock::duration {1}) / tick; // rounded up
+            return static_cast<uint64_t>(std::max<decltype(count)>(count, 0));
+        }
+
+        TimerHandle arm(Clock::duration delay, Clock::duration period, std::function<void()> callback)
+        {
+            auto node = std::make_shared<detail::TimerNode>();
+            node->period = ticks(period);
+            node->callback = std::move(callback);
+
+            const uint64_t expiry = ticks(Clock::now() + delay - start_);
+
+            bool wake = false;
+            {
+                std::lock_guard lk {core_->mtx};
+
+                node->expiry = std::max(expiry, core_->wheel.current() + 1);
+                node->self = node;
+                core_->wheel.insert(node.get());
+
+                if (node->expiry < core_->next_wake)
+                {
+                    core_->next_wake = node->expiry;
+                    wake = true;
+                }
+            }
+
+            if (wake)
+                core_->cv.notify_one();
+
+            return TimerHandle {core_, node};
+        }
+
+        static std::function<void()> make_task(std::shared_ptr<detail::TimerNode> node)
+        {
+            return [node = std::move(node)] {
+                if (node->running.exchange(true)) // previous run has not finished - skip this one
+                    return;
+
+                if (!node->cancelled)
+                    node->callback();
+
+                if (node->period != 0)
+                    node->running = false;
+            };
+        }
+
+        void run()
+        {
+            std::vector<detail::TimerNode*> due;
+            std::vector<std::shared_ptr<detail::TimerNode>> fired;
+
+            std::unique_lock lk {core_->mtx};
+
+            while (!core_->stop)
+            {
+                core_->wheel.advance(ticks(Clock::now() - start_), due);
+
+                for (auto* node : due)
+                {
+                    fired.push_back(node->self);
+
+                    if (node->period != 0)
+                    {
+                        node->expiry = std::max(node->expiry + node->period, core_->wheel.current() + 1);
+                        core_->wheel.insert(node);
+                    }
+                    else
+                        node->self.reset();
+                }
+                due.clear();
+
+                if (!fired.empty())
+                {
+                    lk.unlock();
+                    for (auto& node : fired)
+                        dispatch_(make_task(std::move(node)));
+                    fired.clear();
+                    lk.lock();
+                    continue; // timers may have been added while unlocked
+                }
+
+                const auto next = core_->wheel.next_event();
+                core_->next_wake = next.value_or(std::numeric_limits<uint64_t>::max());
+
+                if (next)
+                    core_->cv.wait_until(lk, start_ + *next * tick);
+                else
+                    core_->cv.wait(lk);
+            }
+        }
+
+        Dispatch dispatch_;
+        const Clock::time_point start_;
+        std::shared_ptr<detail::TimerCore> core_;
+        std::thread thd_;
+    };
+}
+
+#endif // TIMER_WHEEL_HPP
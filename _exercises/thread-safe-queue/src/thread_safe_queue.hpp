@@ -45,7 +45,10 @@ public:
             for(const auto& item : items)
                 queue_.push(std::move(item));
         }
-        cv_queue_not_empty_.notify_all();
+
+        // one waiter per item - notify_all would wake every consumer to fight over the lock
+        for (size_t i = 0; i < items.size(); ++i)
+            cv_queue_not_empty_.notify_one();
     }
 
     bool try_pop(T& item)
@@ -1,3 +1,4 @@
+#include <atomic>
 #include <chrono>
 #include <condition_variable>
 #include <queue>
@@ -87,4 +88,42 @@ TEST_CASE("ThreadSafeQueue")
 
         REQUIRE(none_of(items.begin(), items.end(), [](int x) { return x == 0; }));
     }
+
+    SECTION("batch push wakes as many waiting consumers as it has items")
+    {
+        const int consumers = 5;
+
+        atomic<int> popped {0};
+        vector<thread> threads;
+
+        for (int i = 0; i < consumers; ++i)
+        {
+            threads.emplace_back([&tsq, &popped] {
+                int item;
+                tsq.pop(item);
+                ++popped;
+            });
+        }
+
+        this_thread::sleep_for(200ms); // all consumers are blocked in pop
+
+        tsq.push({1, 2, 3});
+
+        const auto until = chrono::steady_clock::now() + 2s;
+        while (popped < 3 && chrono::steady_clock::now() < until)
+            this_thread::sleep_for(1ms);
+
+        REQUIRE(popped == 3);
+
+        this_thread::sleep_for(50ms);
+        REQUIRE(popped == 3); // the remaining consumers still wait
+
+        tsq.push({4, 5});
+
+        for (auto& thd : threads)
+            thd.join();
+
+        REQUIRE(popped == consumers);
+        REQUIRE(tsq.empty());
+    }
 }
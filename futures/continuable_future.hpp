@@ -0,0 +1,268 @@
+#ifndef CONTINUABLE_FUTURE_HPP
+#define CONTINUABLE_FUTURE_HPP
+
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+// Promise/Future as std::promise/std::future, plus a completion hook: Future::on_ready() registers a callback
+// that the producer runs when it sets the value - so work depending on a future needs no thread waiting for it
+
+namespace detail
+{
+    // void results are stored as std::monostate, so they fit into tuples
+    template <typename T>
+    using StoredT = std::conditional_t<std::is_void_v<T>, std::monostate, T>;
+
+    template <typename T>
+    class SharedState
+    {
+    public:
+        void set_value(StoredT<T> value)
+        {
+            complete([&] { value_.emplace(std::move(value)); });
+        }
+
+        void set_exception(std::exception_ptr eptr)
+        {
+            complete([&] { eptr_ = std::move(eptr); });
+        }
+
+        bool is_ready() const
+        {
+            std::lock_guard lk {mtx_};
+            return ready_;
+        }
+
+        void wait() const
+        {
+            std::unique_lock lk {mtx_};
+            cv_ready_.wait(lk, [this] { return ready_; });
+        }
+
+        template <typename Rep, typename Period>
+        std::future_status wait_for(const std::chrono::duration<Rep, Period>& timeout) const
+        {
+            std::unique_lock lk {mtx_};
+            return cv_ready_.wait_for(lk, timeout, [this] { return ready_; }) ? std::future_status::ready : std::future_status::timeout;
+        }
+
+        StoredT<T> take()
+        {
+            wait();
+
+            if (eptr_)
+                std::rethrow_exception(eptr_);
+            return std::move(*value_);
+        }
+
+        // runs callback on the thread that completes the state, or right away if it is complete
+        void on_ready(std::function<void()> callback)
+        {
+            {
+                std::lock_guard lk {mtx_};
+                if (!ready_)
+                {
+                    callbacks_.push_back(std::move(callback));
+                    return;
+                }
+            }
+
+            callback();
+        }
+
+    private:
+        template <typename Store>
+        void complete(Store store)
+        {
+            std::vector<std::function<void()>> callbacks;
+            {
+                std::lock_guard lk {mtx_};
+                if (ready_)
+                    throw std::future_error {std::future_errc::promise_already_satisfied};
+
+                store();
+                ready_ = true;
+                callbacks.swap(callbacks_);
+            }
+            cv_ready_.notify_all();
+
+            for (auto& callback : callbacks)
+                callback();
+        }
+
+        mutable std::mutex mtx_;
+        mutable std::condition_variable cv_ready_;
+        bool ready_ = false;
+        std::optional<StoredT<T>> value_;
+        std::exception_ptr eptr_;
+        std::vector<std::function<void()>> callbacks_;
+    };
+
+    inline void throw_if_no_state(bool has_state)
+    {
+        if (!has_state)
+            throw std::future_error {std::future_errc::no_state};
+    }
+}
+
+template <typename T>
+class Future
+{
+public:
+    Future() = default;
+
+    bool valid() const
+    {
+        return state_ != nullptr;
+    }
+
+    // like std::future::get() - the future is no longer valid afterwards
+    T get()
+    {
+        detail::throw_if_no_state(valid());
+
+        auto state = std::move(state_);
+        if constexpr (std::is_void_v<T>)
+            state->take();
+        else
+            return state->take();
+    }
+
+    bool is_ready() const
+    {
+        detail::throw_if_no_state(valid());
+        return state_->is_ready();
+    }
+
+    void wait() const
+    {
+        detail::throw_if_no_state(valid());
+        state_->wait();
+    }
+
+    template <typename Rep, typename Period>
+    std::future_status wait_for(const std::chrono::duration<Rep, Period>& timeout) const
+    {
+        detail::throw_if_no_state(valid());
+        return state_->wait_for(timeout);
+    }
+
+    // callback runs once the value or exception is set - on the producer's thread, or right away if already set;
+    // it must not block and must not throw
+    void on_ready(std::function<void()> callback)
+    {
+        detail::throw_if_no_state(valid());
+        state_->on_ready(std::move(callback));
+    }
+
+private:
+    template <typename U>
+    friend class Promise;
+
+    explicit Future(std::shared_ptr<detail::SharedState<T>> state)
+        : state_ {std::move(state)}
+    {
+    }
+
+    std::shared_ptr<detail::SharedState<T>> state_;
+};
+
+template <typename T>
+class Promise
+{
+public:
+    Promise()
+        : state_ {std::make_shared<detail::SharedState<T>>()}
+    {
+    }
+
+    Promise(Promise&&) noexcept = default;
+
+    Promise& operator=(Promise&& other) noexcept
+    {
+        if (this != &other)
+        {
+            abandon();
+            state_ = std::move(other.state_);
+            future_retrieved_ = other.future_retrieved_;
+        }
+        return *this;
+    }
+
+    // an unset promise reports broken_promise, as std::promise does
+    ~Promise()
+    {
+        abandon();
+    }
+
+    Future<T> get_future()
+    {
+        detail::throw_if_no_state(state_ != nullptr);
+        if (std::exchange(future_retrieved_, true))
+            throw std::future_error {std::future_errc::future_already_retrieved};
+
+        return Future<T> {state_};
+    }
+
+    template <typename U = T, typename = std::enable_if_t<!std::is_void_v<U>>>
+    void set_value(detail::StoredT<U> value)
+    {
+        detail::throw_if_no_state(state_ != nullptr);
+        state_->set_value(std::move(value));
+    }
+
+    template <typename U = T, typename = std::enable_if_t<std::is_void_v<U>>>
+    void set_value()
+    {
+        detail::throw_if_no_state(state_ != nullptr);
+        state_->set_value(std::monostate {});
+    }
+
+    void set_exception(std::exception_ptr eptr)
+    {
+        detail::throw_if_no_state(state_ != nullptr);
+        state_->set_exception(std::move(eptr));
+    }
+
+    // stores the value returned by callable or the exception it throws
+    template <typename Callable>
+    void set_from(Callable&& callable)
+    {
+        try
+        {
+            if constexpr (std::is_void_v<T>)
+            {
+                std::forward<Callable>(callable)();
+                set_value();
+            }
+            else
+                set_value(std::forward<Callable>(callable)());
+        }
+        catch (...)
+        {
+            set_exception(std::current_exception());
+        }
+    }
+
+private:
+    void abandon()
+    {
+        if (state_ && !state_->is_ready())
+            state_->set_exception(std::make_exception_ptr(std::future_error {std::future_errc::broken_promise}));
+    }
+
+    std::shared_ptr<detail::SharedState<T>> state_;
+    bool future_retrieved_ = false;
+};
+
+#endif // CONTINUABLE_FUTURE_HPP
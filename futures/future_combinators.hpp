@@ -0,0 +1,284 @@
+#ifndef FUTURE_COMBINATORS_HPP
+#define FUTURE_COMBINATORS_HPP
+
+#include "continuable_future.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+// thrown (through the combined future) when some of the input futures failed;
+// exceptions are kept in input order, nullptr for inputs that succeeded
+class AggregateException : public std::runtime_error
+{
+public:
+    explicit AggregateException(std::vector<std::exception_ptr> exceptions)
+        : std::runtime_error {message(exceptions)}
+        , exceptions_ {std::move(exceptions)}
+    {
+    }
+
+    const std::vector<std::exception_ptr>& exceptions() const
+    {
+        return exceptions_;
+    }
+
+private:
+    std::vector<std::exception_ptr> exceptions_;
+
+    static std::string message(const std::vector<std::exception_ptr>& exceptions)
+    {
+        size_t failed = 0;
+        for (const auto& eptr : exceptions)
+            if (eptr)
+                ++failed;
+
+        return std::to_string(failed) + " of " + std::to_string(exceptions.size()) + " futures failed";
+    }
+};
+
+template <typename T>
+struct WhenAnyResult
+{
+    size_t index; // position of the future that delivered the value
+    T value;
+};
+
+template <>
+struct WhenAnyResult<void>
+{
+    size_t index;
+};
+
+namespace detail
+{
+    template <typename T>
+    void get_into(Future<T>& future, std::optional<StoredT<T>>& value, std::exception_ptr& eptr)
+    {
+        try
+        {
+            if constexpr (std::is_void_v<T>)
+            {
+                future.get();
+                value.emplace();
+            }
+            else
+                value.emplace(future.get());
+        }
+        catch (...)
+        {
+            eptr = std::current_exception();
+        }
+    }
+
+    inline bool any_failed(const std::vector<std::exception_ptr>& exceptions)
+    {
+        for (const auto& eptr : exceptions)
+            if (eptr)
+                return true;
+        return false;
+    }
+
+    template <typename T>
+    struct WhenAllState
+    {
+        using ResultT = std::conditional_t<std::is_void_v<T>, void, std::vector<T>>;
+
+        explicit WhenAllState(std::vector<Future<T>> inputs)
+            : futures {std::move(inputs)}
+            , values(futures.size())
+            , errors(futures.size())
+            , pending {futures.size()}
+        {
+        }
+
+        // called by the producer of each input once it is ready; the last one sets the result
+        void arrive(size_t index)
+        {
+            get_into(futures[index], values[index], errors[index]);
+
+            if (pending.fetch_sub(1, std::memory_order_acq_rel) == 1)
+                finish();
+        }
+
+        void finish()
+        {
+            if (any_failed(errors))
+                promise.set_exception(std::make_exception_ptr(AggregateException {std::move(errors)}));
+            else if constexpr (std::is_void_v<T>)
+                promise.set_value();
+            else
+            {
+                std::vector<T> results;
+                results.reserve(values.size());
+                for (auto& value : values)
+                    results.push_back(std::move(*value));
+                promise.set_value(std::move(results));
+            }
+        }
+
+        std::vector<Future<T>> futures;
+        std::vector<std::optional<StoredT<T>>> values;
+        std::vector<std::exception_ptr> errors; // every element written by the producer of its own input
+        std::atomic<size_t> pending;
+        Promise<ResultT> promise;
+    };
+
+    template <typename... Ts>
+    struct WhenAllTupleState
+    {
+        using ResultT = std::tuple<StoredT<Ts>...>;
+
+        explicit WhenAllTupleState(Future<Ts>... inputs)
+            : futures {std::move(inputs)...}
+        {
+        }
+
+        template <size_t I>
+        void arrive()
+        {
+            get_into(std::get<I>(futures), std::get<I>(values), errors[I]);
+
+            if (pending.fetch_sub(1, std::memory_order_acq_rel) != 1)
+                return;
+
+            if (any_failed(errors))
+                promise.set_exception(std::make_exception_ptr(AggregateException {std::move(errors)}));
+            else
+                promise.set_value(std::apply([](auto&... value) { return ResultT {std::move(*value)...}; }, values));
+        }
+
+        std::tuple<Future<Ts>...> futures;
+        std::tuple<std::optional<StoredT<Ts>>...> values;
+        std::vector<std::exception_ptr> errors = std::vector<std::exception_ptr>(sizeof...(Ts));
+        std::atomic<size_t> pending {sizeof...(Ts)};
+        Promise<ResultT> promise;
+    };
+
+    template <typename State, size_t... Is>
+    void subscribe_all(const std::shared_ptr<State>& state, std::index_sequence<Is...>)
+    {
+        (std::get<Is>(state->futures).on_ready([state] { state->template arrive<Is>(); }), ...);
+    }
+
+    template <typename T>
+    struct WhenAnyState
+    {
+        explicit WhenAnyState(std::vector<Future<T>> inputs)
+            : futures {std::move(inputs)}
+            , errors(futures.size())
+        {
+        }
+
+        // the first value wins; the result fails only with the last failed input
+        void arrive(size_t index)
+        {
+            try
+            {
+                if constexpr (std::is_void_v<T>)
+                {
+                    futures[index].get();
+                    if (!done.exchange(true))
+                        promise.set_value(WhenAnyResult<void> {index});
+                }
+                else
+                {
+                    auto value = futures[index].get();
+                    if (!done.exchange(true))
+                        promise.set_value(WhenAnyResult<T> {index, std::move(value)});
+                }
+            }
+            catch (...)
+            {
+                errors[index] = std::current_exception();
+
+                if (failures.fetch_add(1, std::memory_order_acq_rel) + 1 == errors.size())
+                    promise.set_exception(std::make_exception_ptr(AggregateException {std::move(errors)}));
+            }
+        }
+
+        std::vector<Future<T>> futures;
+        std::vector<std::exception_ptr> errors; // every element written by the producer of its own input
+        std::atomic<bool> done {false};
+        std::atomic<size_t> failures {0};
+        Promise<WhenAnyResult<T>> promise;
+    };
+}
+
+// the combinators take Future (continuable_future.hpp), not std::future: std::future has no completion hook,
+// so combining it would need a thread blocked on, or polling, the inputs; here the producer that completes
+// the last (when_all) or the first (when_any) input also sets the result, on its own thread - no thread waits;
+// the combined state lives until every input is set (or its Promise destroyed - broken_promise)
+
+// ready when all futures are; values in input order, or AggregateException if any of them failed
+template <typename T>
+auto when_all(std::vector<Future<T>> futures)
+{
+    using StateT = detail::WhenAllState<T>;
+
+    auto state = std::make_shared<StateT>(std::move(futures));
+    Future<typename StateT::ResultT> result = state->promise.get_future();
+
+    if (state->futures.empty())
+        state->finish();
+
+    for (size_t i = 0; i < state->futures.size(); ++i)
+        state->futures[i].on_ready([state, i] { state->arrive(i); });
+
+    return result;
+}
+
+// ready when all futures are; a tuple of values (std::monostate for void futures) or AggregateException
+template <typename... Ts>
+auto when_all(Future<Ts>... futures)
+{
+    static_assert(sizeof...(Ts) > 0, "when_all needs at least one future");
+
+    using StateT = detail::WhenAllTupleState<Ts...>;
+
+    auto state = std::make_shared<StateT>(std::move(futures)...);
+    Future<typename StateT::ResultT> result = state->promise.get_future();
+
+    detail::subscribe_all(state, std::index_sequence_for<Ts...> {});
+
+    return result;
+}
+
+// ready with the first value delivered; AggregateException only if every future failed
+template <typename T>
+auto when_any(std::vector<Future<T>> futures)
+{
+    if (futures.empty())
+        throw std::invalid_argument("when_any needs at least one future");
+
+    auto state = std::make_shared<detail::WhenAnyState<T>>(std::move(futures));
+    Future<WhenAnyResult<T>> result = state->promise.get_future();
+
+    for (size_t i = 0; i < state->futures.size(); ++i)
+        state->futures[i].on_ready([state, i] { state->arrive(i); });
+
+    return result;
+}
+
+template <typename T, typename... Ts>
+auto when_any(Future<T> first, Future<Ts>... rest)
+{
+    static_assert((std::is_same_v<T, Ts> && ...), "when_any needs futures of the same type");
+
+    std::vector<Future<T>> futures;
+    futures.reserve(1 + sizeof...(Ts));
+    futures.push_back(std::move(first));
+    (futures.push_back(std::move(rest)), ...);
+
+    return when_any(std::move(futures));
+}
+
+#endif // FUTURE_COMBINATORS_HPP
@@ -1,3 +1,5 @@
+#include "future_combinators.hpp"
+
 #include <cassert>
 #include <chrono>
 #include <functional>
@@ -107,6 +109,57 @@ void using_promise()
     thd_consumer2.join();
 }
 
+void using_when_all()
+{
+    // the combinators need futures with a completion hook - Future, set through a Promise by its producer
+    std::vector<std::thread> producers;
+    const auto launch_square = [&producers](int arg) {
+        Promise<int> promise;
+        Future<int> square = promise.get_future();
+        producers.emplace_back([arg, promise = std::move(promise)]() mutable {
+            promise.set_from([arg] { return calculate_square(arg); });
+        });
+        return square;
+    };
+
+    std::vector<Future<int>> squares;
+    for (int arg : {1, 2, 3, 4, 5, 6})
+        squares.push_back(launch_square(arg));
+
+    Future<WhenAnyResult<int>> first = when_any(launch_square(7), launch_square(8));
+
+    Future<std::vector<int>> all = when_all(std::move(squares)); // set by the producer of the last square
+
+    WhenAnyResult<int> winner = first.get();
+    std::cout << "First square: " << winner.value << " (future#" << winner.index << ")" << std::endl;
+
+    try
+    {
+        for (int square : all.get())
+            std::cout << square << std::endl;
+    }
+    catch (const AggregateException& e)
+    {
+        std::cout << "CAUGHT: " << e.what() << std::endl;
+
+        for (size_t i = 0; i < e.exceptions().size(); ++i)
+        {
+            try
+            {
+                if (e.exceptions()[i])
+                    std::rethrow_exception(e.exceptions()[i]);
+            }
+            catch (const std::exception& inner)
+            {
+                std::cout << "  future#" << i << ": " << inner.what() << std::endl;
+            }
+        }
+    }
+
+    for (auto& producer : producers)
+        producer.join();
+}
+
 int main()
 {
     // {
@@ -167,4 +220,6 @@ int main()
     // std::this_thread::sleep_for(2s);
 
     using_promise();
+
+    using_when_all();
 }
@@ -0,0 +1,257 @@
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "future_combinators.hpp"
+
+using namespace std;
+using namespace std::literals;
+
+namespace
+{
+    template <typename T>
+    vector<Future<T>> futures_of(vector<Promise<T>>& promises)
+    {
+        vector<Future<T>> futures;
+        for (auto& promise : promises)
+            futures.push_back(promise.get_future());
+        return futures;
+    }
+
+    string message_of(const exception_ptr& eptr)
+    {
+        try
+        {
+            rethrow_exception(eptr);
+        }
+        catch (const exception& e)
+        {
+            return e.what();
+        }
+    }
+}
+
+TEST_CASE("Future")
+{
+    Promise<int> promise;
+    Future<int> future = promise.get_future();
+
+    SECTION("get returns the value set by the promise")
+    {
+        thread producer {[&promise] { promise.set_value(42); }};
+        REQUIRE(future.get() == 42);
+        REQUIRE(future.valid() == false);
+        producer.join();
+    }
+
+    SECTION("get rethrows the exception set by the promise")
+    {
+        promise.set_from([]() -> int { throw runtime_error("failed"); });
+        REQUIRE_THROWS_AS(future.get(), runtime_error);
+    }
+
+    SECTION("on_ready runs on the producer's thread when the value is set")
+    {
+        thread::id callback_thread;
+        future.on_ready([&callback_thread] { callback_thread = this_thread::get_id(); });
+
+        thread producer {[&promise] { promise.set_value(1); }};
+        const thread::id producer_thread = producer.get_id();
+        producer.join();
+
+        REQUIRE(callback_thread == producer_thread);
+    }
+
+    SECTION("on_ready runs at once for a ready future")
+    {
+        promise.set_value(1);
+
+        bool called = false;
+        future.on_ready([&called] { called = true; });
+
+        REQUIRE(called);
+    }
+
+    SECTION("a destroyed promise reports broken_promise")
+    {
+        {
+            Promise<int> abandoned = std::move(promise);
+        }
+        REQUIRE_THROWS_AS(future.get(), future_error);
+    }
+
+    SECTION("get_future can be called once")
+    {
+        REQUIRE_THROWS_AS(promise.get_future(), future_error);
+    }
+}
+
+TEST_CASE("when_all")
+{
+    SECTION("values in input order, whatever the completion order")
+    {
+        vector<Promise<int>> promises(3);
+        Future<vector<int>> all = when_all(futures_of(promises));
+
+        promises[2].set_value(3);
+        promises[0].set_value(1);
+        REQUIRE(all.is_ready() == false);
+        promises[1].set_value(2);
+
+        REQUIRE(all.is_ready()); // set by the last producer - no thread waits for the inputs
+        REQUIRE(all.get() == vector<int> {1, 2, 3});
+    }
+
+    SECTION("inputs completed by other threads")
+    {
+        vector<Promise<int>> promises(8);
+        Future<vector<int>> all = when_all(futures_of(promises));
+
+        vector<thread> producers;
+        for (int i = 0; i < 8; ++i)
+            producers.emplace_back([&promises, i] { promises[i].set_value(i * i); });
+
+        REQUIRE(all.get() == vector<int> {0, 1, 4, 9, 16, 25, 36, 49});
+
+        for (auto& producer : producers)
+            producer.join();
+    }
+
+    SECTION("AggregateException with the exceptions of the failed inputs in input order")
+    {
+        vector<Promise<int>> promises(3);
+        Future<vector<int>> all = when_all(futures_of(promises));
+
+        promises[0].set_value(1);
+        promises[1].set_exception(make_exception_ptr(runtime_error("second")));
+        promises[2].set_exception(make_exception_ptr(logic_error("third")));
+
+        try
+        {
+            all.get();
+            FAIL("AggregateException expected");
+        }
+        catch (const AggregateException& e)
+        {
+            REQUIRE(string(e.what()) == "2 of 3 futures failed");
+            REQUIRE(e.exceptions().size() == 3);
+            REQUIRE(e.exceptions()[0] == nullptr);
+            REQUIRE(message_of(e.exceptions()[1]) == "second");
+            REQUIRE(message_of(e.exceptions()[2]) == "third");
+        }
+    }
+
+    SECTION("an empty range is ready at once")
+    {
+        Future<vector<int>> all = when_all(vector<Future<int>> {});
+
+        REQUIRE(all.get().empty());
+    }
+
+    SECTION("void futures")
+    {
+        vector<Promise<void>> promises(2);
+        Future<void> all = when_all(futures_of(promises));
+
+        promises[0].set_value();
+        promises[1].set_value();
+
+        REQUIRE_NOTHROW(all.get());
+    }
+
+    SECTION("futures of different types give a tuple")
+    {
+        Promise<int> number;
+        Promise<string> text;
+        Promise<void> done;
+
+        auto all = when_all(number.get_future(), text.get_future(), done.get_future());
+
+        text.set_value("text");
+        done.set_value();
+        number.set_value(7);
+
+        REQUIRE(all.get() == make_tuple(7, "text"s, monostate {}));
+    }
+}
+
+TEST_CASE("when_any")
+{
+    SECTION("the first value wins")
+    {
+        vector<Promise<int>> promises(3);
+        Future<WhenAnyResult<int>> any = when_any(futures_of(promises));
+
+        promises[1].set_value(2);
+
+        REQUIRE(any.is_ready());
+        const WhenAnyResult<int> first = any.get();
+        REQUIRE(first.index == 1);
+        REQUIRE(first.value == 2);
+
+        promises[0].set_value(1); // a late loser changes nothing
+    }
+
+    SECTION("a loser that never completes does not hold the result")
+    {
+        Promise<int> never;
+        Promise<int> fast;
+        Future<WhenAnyResult<int>> any = when_any(never.get_future(), fast.get_future());
+
+        thread producer {[&fast] { fast.set_value(42); }};
+
+        REQUIRE(any.wait_for(1s) == future_status::ready);
+        REQUIRE(any.get().index == 1);
+
+        producer.join();
+    }
+
+    SECTION("a failed input is skipped while others may still deliver")
+    {
+        vector<Promise<string>> promises(2);
+        Future<WhenAnyResult<string>> any = when_any(futures_of(promises));
+
+        promises[0].set_exception(make_exception_ptr(runtime_error("first")));
+        REQUIRE(any.is_ready() == false);
+        promises[1].set_value("second");
+
+        const auto first = any.get();
+        REQUIRE(first.index == 1);
+        REQUIRE(first.value == "second");
+    }
+
+    SECTION("AggregateException when every input failed")
+    {
+        Promise<void> failed;
+        Promise<void> abandoned;
+        Future<WhenAnyResult<void>> any = when_any(failed.get_future(), abandoned.get_future());
+
+        failed.set_exception(make_exception_ptr(runtime_error("failed")));
+        {
+            Promise<void> dropped = std::move(abandoned);
+        }
+
+        try
+        {
+            any.get();
+            FAIL("AggregateException expected");
+        }
+        catch (const AggregateException& e)
+        {
+            REQUIRE(e.exceptions().size() == 2);
+            REQUIRE(message_of(e.exceptions()[0]) == "failed");
+            REQUIRE_THROWS_AS(rethrow_exception(e.exceptions()[1]), future_error);
+        }
+    }
+
+    SECTION("an empty range is rejected")
+    {
+        REQUIRE_THROWS_AS(when_any(vector<Future<int>> {}), invalid_argument);
+    }
+}
@@ -0,0 +1,218 @@
+#ifndef EPOCH_RECLAMATION_HPP
+#define EPOCH_RECLAMATION_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+// epoch-based reclamation for lock-free readers:
+//  - a reader pins the current epoch with an EpochDomain::Guard for as long as it dereferences shared pointers,
+//  - a writer unlinks an object (so no new reader can reach it) and retires it,
+//  - a retired object is freed once the epoch has advanced twice - every reader that could have seen it
+//    has left its guard by then; the epoch advances only when all pinned readers are in the current one
+// readers write only to their own record (a cache line per record); a guard held forever stops all reclamation
+class EpochDomain
+{
+private:
+    struct alignas(64) Record
+    {
+        std::atomic<bool> in_use {false}; // owned by a guard
+        std::atomic<uint64_t> epoch {0};  // pinned epoch, 0 - not pinned
+        Record* next = nullptr;           // records are never removed from the list
+    };
+
+    struct Retired
+    {
+        void* object;
+        void (*deleter)(void*);
+    };
+
+    static constexpr size_t collect_threshold = 64; // retirements between attempts to advance the epoch
+
+    const uint64_t id_;
+    std::atomic<uint64_t> epoch_ {1};
+    std::atomic<Record*> records_ {nullptr};
+    std::mutex mtx_retired_;
+    std::array<std::vector<Retired>, 3> retired_; // by epoch % 3 of retirement
+    size_t retired_since_collect_ = 0;
+
+    static uint64_t next_id()
+    {
+        static std::atomic<uint64_t> last_id {0};
+        return ++last_id;
+    }
+
+    // the records a thread used last - a guard usually reuses its thread's record without touching others
+    struct CachedRecord
+    {
+        uint64_t domain_id = 0;
+        Record* record = nullptr;
+    };
+
+    static CachedRecord* record_cache()
+    {
+        thread_local std::array<CachedRecord, 4> cache {};
+        return cache.data();
+    }
+
+    static bool try_own(Record* record)
+    {
+        return !record->in_use.load(std::memory_order_relaxed) && !record->in_use.exchange(true, std::memory_order_acquire);
+    }
+
+    Record* acquire_record()
+    {
+        CachedRecord* cache = record_cache();
+        for (size_t i = 0; i < 4; ++i)
+            if (cache[i].domain_id == id_ && try_own(cache[i].record))
+                return cache[i].record;
+
+        Record* record = records_.load(std::memory_order_acquire);
+        while (record != nullptr && !try_own(record))
+            record = record->next;
+
+        if (record == nullptr)
+        {
+            record = new Record;
+            record->in_use.store(true, std::memory_order_relaxed);
+            record->next = records_.load(std::memory_order_relaxed);
+            while (!records_.compare_exchange_weak(record->next, record, std::memory_order_release, std::memory_order_relaxed))
+                ;
+        }
+
+        // replaces an entry of another domain first, then the oldest one
+        CachedRecord* slot = cache + 3;
+        for (size_t i = 0; i < 4; ++i)
+        {
+            if (cache[i].domain_id != id_)
+            {
+                slot = cache + i;
+                break;
+            }
+        }
+        std::move_backward(cache, slot, slot + 1);
+        cache[0] = CachedRecord{id_, record};
+
+        return record;
+    }
+
+    // called under mtx_retired_; returns the objects that became safe to free
+    std::vector<Retired> try_advance()
+    {
+        const uint64_t epoch = epoch_.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        for (Record* record = records_.load(std::memory_order_acquire); record != nullptr; record = record->next)
+        {
+            const uint64_t pinned = record->epoch.load(std::memory_order_acquire); // pairs with the unpinning in ~Guard
+            if (pinned != 0 && pinned != epoch)
+                return {};
+        }
+
+        epoch_.store(epoch + 1, std::memory_order_release);
+
+        // retired two epochs before the new one
+        return std::exchange(retired_[(epoch + 2) % 3], {});
+    }
+
+    static void free_all(std::vector<Retired>& retired)
+    {
+        for (const Retired& item : retired)
+            item.deleter(item.object);
+    }
+
+public:
+    // pins the epoch of the domain - objects retired meanwhile stay alive until the guard is gone
+    class Guard
+    {
+    public:
+        explicit Guard(EpochDomain& domain = EpochDomain::global())
+            : record_{domain.acquire_record()}
+        {
+            record_->epoch.store(domain.epoch_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+        ~Guard()
+        {
+            record_->epoch.store(0, std::memory_order_release);
+            record_->in_use.store(false, std::memory_order_release);
+        }
+
+    private:
+        Record* record_;
+    };
+
+    EpochDomain()
+        : id_{next_id()}
+    {
+    }
+
+    EpochDomain(const EpochDomain&) = delete;
+    EpochDomain& operator=(const EpochDomain&) = delete;
+
+    // no guards may be alive
+    ~EpochDomain()
+    {
+        for (auto& retired : retired_)
+            free_all(retired);
+
+        for (Record* record = records_.load(); record != nullptr;)
+            delete std::exchange(record, record->next);
+    }
+
+    // shared by all users that do not need a domain of their own; never destroyed, so guards
+    // and retirements stay valid during static destruction
+    static EpochDomain& global()
+    {
+        static EpochDomain* domain = new EpochDomain;
+        return *domain;
+    }
+
+    // the object must already be unreachable for readers that pin the epoch from now on
+    void retire(void* object, void (*deleter)(void*))
+    {
+        std::vector<Retired> reclaimable;
+        {
+            std::lock_guard lk{mtx_retired_};
+
+            retired_[epoch_.load(std::memory_order_relaxed) % 3].push_back(Retired{object, deleter});
+
+            if (++retired_since_collect_ >= collect_threshold)
+            {
+                retired_since_collect_ = 0;
+                reclaimable = try_advance();
+            }
+        }
+
+        free_all(reclaimable);
+    }
+
+    template <typename T>
+    void retire(T* object)
+    {
+        retire(object, [](void* p) { delete static_cast<T*>(p); });
+    }
+
+    // advances the epoch if readers allow and frees what has become safe
+    void collect()
+    {
+        std::vector<Retired> reclaimable;
+        {
+            std::lock_guard lk{mtx_retired_};
+            retired_since_collect_ = 0;
+            reclaimable = try_advance();
+        }
+
+        free_all(reclaimable);
+    }
+};
+
+#endif // EPOCH_RECLAMATION_HPP
@@ -0,0 +1,803 @@
+#ifndef LOOKUP_TABLE_STORAGE_HPP
+#define LOOKUP_TABLE_STORAGE_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <new>
+#include <optional>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+#include "epoch_reclamation.hpp"
+
+// storage policies of ThreadSafeLookupTable - Storage::Bucket holds the entries of one bucket, the table does the locking;
+// hash is the table's hash of the key (Hash with its bits spread by detail::mix_hash - the table picks the bucket
+// from its low bits), hasher computes it for the stored keys of operations that have to rehash;
+// default_max_load_factor - entries per bucket before the table grows;
+// Bucket::optimistic_reads - find_optimistic() may run concurrently with writers (the table validates its result);
+// Bucket::lock_free_reads - find_lock_free() may run concurrently with writers under an EpochDomain::Guard;
+// lookups take any K that EqualTo compares with Key (heterogeneous lookup), a Key is built from K only on insertion;
+// update() applies f(Value&) to the value of the key, try_emplace() constructs a value only if the key is absent;
+// prefetch(hash) starts loading the memory a lookup of the hash reads first (batched lookups issue it ahead)
+
+namespace detail
+{
+    inline void prefetch(const void* address)
+    {
+#if defined(__GNUC__) || defined(__clang__)
+        __builtin_prefetch(address);
+#else
+        (void)address;
+#endif
+    }
+}
+
+// linked list of nodes - an allocation per entry and a pointer chase per probe
+struct ListStorage
+{
+    static constexpr float default_max_load_factor = 1.0f;
+
+    template <typename Key, typename Value, typename Hash, typename EqualTo>
+    class Bucket
+    {
+    public:
+        static constexpr bool optimistic_reads = false;
+        static constexpr bool lock_free_reads = false;
+
+    private:
+        using bucket_value = std::pair<Key, Value>;
+        using bucket_data = std::list<bucket_value>;
+        using bucket_iterator = typename bucket_data::iterator;
+        using bucket_const_iterator = typename bucket_data::const_iterator;
+
+        bucket_data data_;
+
+        template <typename K>
+        bucket_iterator find_entry_for(const K& key)
+        {
+            return std::find_if(data_.begin(), data_.end(), [&key](const auto& item) { return EqualTo{}(item.first, key); });
+        }
+
+        template <typename K>
+        bucket_const_iterator find_entry_for(const K& key) const
+        {
+            return std::find_if(data_.begin(), data_.end(), [&key](const auto& item) { return EqualTo{}(item.first, key); });
+        }
+
+    public:
+        template <typename K>
+        const Value* find(const K& key, size_t /*hash*/) const
+        {
+            const bucket_const_iterator found_entry = find_entry_for(key);
+            return (found_entry == data_.end()) ? nullptr : &found_entry->second;
+        }
+
+        // returns true if the key was not there
+        template <typename K, typename V>
+        bool insert_or_assign(const K& key, size_t /*hash*/, V&& value, const Hash& /*hasher*/)
+        {
+            const bucket_iterator found_entry = find_entry_for(key);
+
+            if (found_entry == data_.end())
+            {
+                data_.emplace_back(key, std::forward<V>(value));
+                return true;
+            }
+
+            found_entry->second = std::forward<V>(value);
+            return false;
+        }
+
+        // returns true if the key was not there
+        template <typename K, typename... Args>
+        bool try_emplace(const K& key, size_t /*hash*/, const Hash& /*hasher*/, Args&&... args)
+        {
+            if (find_entry_for(key) != data_.end())
+                return false;
+
+            data_.emplace_back(std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+            return true;
+        }
+
+        // returns false if the key is not there
+        template <typename K, typename F>
+        bool update(const K& key, size_t /*hash*/, F&& f)
+        {
+            const bucket_iterator found_entry = find_entry_for(key);
+            if (found_entry == data_.end())
+                return false;
+
+            std::forward<F>(f)(found_entry->second);
+            return true;
+        }
+
+        template <typename K>
+        bool erase(const K& key, size_t /*hash*/)
+        {
+            const bucket_iterator found_entry = find_entry_for(key);
+            if (found_entry == data_.end())
+                return false;
+
+            data_.erase(found_entry);
+            return true;
+        }
+
+        void prefetch(size_t /*hash*/) const
+        {
+            if (!data_.empty())
+                detail::prefetch(&data_.front());
+        }
+
+        // moves entries for which predicate(key, hash) holds to the target - the nodes are relinked, not copied
+        template <typename Predicate>
+        void move_if(Bucket& target, Predicate predicate, const Hash& hasher)
+        {
+            for (bucket_iterator it = data_.begin(); it != data_.end();)
+            {
+                const bucket_iterator next = std::next(it);
+                if (predicate(it->first, hasher(it->first)))
+                    target.data_.splice(target.data_.end(), data_, it);
+                it = next;
+            }
+        }
+
+        size_t size() const
+        {
+            return data_.size();
+        }
+    };
+};
+
+// seqlock readers race with writers by design and discard what they read if a writer interfered
+#if defined(__GNUC__) || defined(__clang__)
+#define LOOKUP_TABLE_NO_SANITIZE_THREAD __attribute__((no_sanitize("thread")))
+#else
+#define LOOKUP_TABLE_NO_SANITIZE_THREAD
+#endif
+
+namespace detail
+{
+    // SWAR helpers over a group of 8 control bytes packed into a word (byte i - slot i)
+    constexpr uint64_t lsbs = 0x0101010101010101ULL;
+    constexpr uint64_t msbs = 0x8080808080808080ULL;
+
+    // high bit set in bytes equal to b (may also flag a byte above a true match - callers recheck)
+    inline uint64_t match_byte(uint64_t group, uint8_t b)
+    {
+        const uint64_t x = group ^ (lsbs * b);
+        return (x - lsbs) & ~x & msbs;
+    }
+
+    // high bit set in bytes equal to 0x80 (empty)
+    inline uint64_t match_empty(uint64_t group)
+    {
+        return group & (~group << 6) & msbs;
+    }
+
+    // high bit set in bytes with the high bit set (empty or deleted)
+    inline uint64_t match_free(uint64_t group)
+    {
+        return group & msbs;
+    }
+
+    inline size_t lowest_byte(uint64_t match)
+    {
+#if defined(__GNUC__)
+        return static_cast<size_t>(__builtin_ctzll(match)) / 8;
+#else
+        size_t i = 0;
+        for (; (match & 0x80) == 0; match >>= 8)
+            ++i;
+        return i;
+#endif
+    }
+
+    // spreads the bits of weak hashes (std::hash of integers and pointers is the identity) - the low half
+    // folds in the high half of the product, which depends on all bits of the input
+    inline uint64_t mix_hash(size_t hash)
+    {
+        uint64_t h = static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ULL;
+        return h ^ (h >> 32);
+    }
+}
+
+// open addressing in contiguous arrays with SwissTable-style control bytes: a control byte per slot holds 7 bits
+// of the hash (or empty/deleted), so a probe compares a group of 8 slots at once and touches only matching slots;
+// with plain keys (arithmetic, enum or pointer, compared by std::equal_to) and trivially copyable values the bucket
+// supports optimistic reads - arrays it outgrows are kept
+// as spares for later rehashes instead of being freed, so a reader holding a stale pointer still reads memory
+// of this bucket (at most one spare per capacity - bounded by twice the largest capacity)
+struct FlatStorage
+{
+    static constexpr float default_max_load_factor = 4.0f; // a bucket mostly fits into its first group of 8 slots
+
+    template <typename Key, typename Value, typename Hash, typename EqualTo>
+    class Bucket
+    {
+    public:
+        // an optimistic read compares a possibly torn copy of a stored key - only keys whose comparison cannot
+        // fault (nor run user code) on any bits qualify
+        template <typename T>
+        static constexpr bool is_plain_key = std::is_arithmetic_v<T> || std::is_enum_v<T> || std::is_pointer_v<T>;
+
+        static constexpr bool optimistic_reads = is_plain_key<Key>
+            && (std::is_same_v<EqualTo, std::equal_to<Key>> || std::is_same_v<EqualTo, std::equal_to<>>)
+            && std::is_trivially_copyable_v<Value>;
+        static constexpr bool lock_free_reads = false;
+
+    private:
+        using bucket_value = std::pair<Key, Value>;
+
+        static constexpr size_t group_width = 8;
+        static constexpr size_t npos = static_cast<size_t>(-1);
+        static constexpr size_t next_group = npos - 1; // probe visitor: go on with the next group
+        static constexpr uint8_t empty = 0x80;
+        static constexpr uint8_t deleted = 0xFE;
+
+        // control bytes and slots in one allocation; the capacity never changes, so a reader loading
+        // the pointer without a lock gets a consistent capacity with it
+        struct Arrays
+        {
+            size_t capacity;
+            Arrays* next_spare = nullptr;
+
+            static constexpr size_t alignment = std::max(alignof(bucket_value), alignof(size_t));
+
+            static size_t slots_offset(size_t capacity)
+            {
+                return (sizeof(Arrays) + capacity + alignof(bucket_value) - 1) / alignof(bucket_value) * alignof(bucket_value);
+            }
+
+            static Arrays* allocate(size_t capacity)
+            {
+                void* memory = ::operator new(slots_offset(capacity) + capacity * sizeof(bucket_value), std::align_val_t{alignment});
+                return ::new (memory) Arrays{capacity};
+            }
+
+            static void deallocate(Arrays* arrays)
+            {
+                ::operator delete(arrays, std::align_val_t{alignment});
+            }
+
+            uint8_t* ctrl()
+            {
+                return reinterpret_cast<uint8_t*>(this + 1);
+            }
+
+            bucket_value* slots()
+            {
+                return reinterpret_cast<bucket_value*>(reinterpret_cast<char*>(this) + slots_offset(capacity));
+            }
+        };
+
+        std::atomic<Arrays*> arrays_ {nullptr}; // published for optimistic readers
+        Arrays* spares_ = nullptr;
+        uint8_t* ctrl_ = nullptr;
+        bucket_value* slots_ = nullptr; // slots are constructed where the control byte is full
+        size_t capacity_ = 0;           // 0 or a power of 2, multiple of group_width
+        size_t size_ = 0;
+        size_t growth_left_ = 0; // empty slots that may still be filled - keeps the load below 7/8
+
+        static bool is_full(uint8_t ctrl)
+        {
+            return (ctrl & 0x80) == 0;
+        }
+
+        // keys of one bucket share the low bits of their hashes - the probe uses the high ones
+        static size_t h1(uint64_t hash)
+        {
+            return static_cast<size_t>(hash >> 32);
+        }
+
+        static uint8_t h2(uint64_t hash)
+        {
+            return static_cast<uint8_t>(hash >> 57);
+        }
+
+        uint64_t load_group(size_t group) const
+        {
+            uint64_t word = 0;
+            for (size_t i = 0; i < group_width; ++i)
+                word |= uint64_t{ctrl_[group * group_width + i]} << (8 * i);
+            return word;
+        }
+
+        // groups visited in triangular order (+1, +2, +3...) - covers all of them for a power-of-2 count
+        template <typename Visitor>
+        size_t probe(uint64_t hash, Visitor visit) const
+        {
+            const size_t groups_mask = capacity_ / group_width - 1;
+            size_t group = h1(hash) & groups_mask;
+
+            for (size_t step = 1; step <= groups_mask + 1; ++step)
+            {
+                const size_t slot = visit(group, load_group(group));
+                if (slot != next_group)
+                    return slot;
+
+                group = (group + step) & groups_mask;
+            }
+
+            return npos;
+        }
+
+        template <typename K>
+        size_t find_slot(const K& key, size_t hash) const
+        {
+            if (size_ == 0)
+                return npos;
+
+            const uint8_t fragment = h2(hash);
+
+            return probe(hash, [&](size_t group, uint64_t ctrl) {
+                for (uint64_t match = detail::match_byte(ctrl, fragment); match != 0; match &= match - 1)
+                {
+                    const size_t slot = group * group_width + detail::lowest_byte(match);
+                    if (ctrl_[slot] == fragment && EqualTo{}(slots_[slot].first, key))
+                        return slot;
+                }
+
+                return detail::match_empty(ctrl) != 0 ? npos : next_group; // an empty slot ends the probe sequence
+            });
+        }
+
+        size_t find_free_slot(uint64_t hash) const
+        {
+            return probe(hash, [&](size_t group, uint64_t ctrl) {
+                const uint64_t match = detail::match_free(ctrl);
+                return match != 0 ? group * group_width + detail::lowest_byte(match) : next_group;
+            });
+        }
+
+        template <typename... Args>
+        void construct_at(size_t slot, uint64_t hash, Args&&... args)
+        {
+            ::new (static_cast<void*>(slots_ + slot)) bucket_value(std::forward<Args>(args)...);
+
+            if (ctrl_[slot] == empty)
+                --growth_left_;
+            ctrl_[slot] = h2(hash);
+            ++size_;
+        }
+
+        template <typename... Args>
+        void emplace_new(size_t hash, const Hash& hasher, Args&&... args)
+        {
+            if (growth_left_ == 0) // full of entries or tombstones - grow only in the former case
+                rehash(std::max(group_width, size_ * 2 >= capacity_ - capacity_ / 8 ? capacity_ * 2 : capacity_), hasher);
+
+            construct_at(find_free_slot(hash), hash, std::forward<Args>(args)...);
+        }
+
+        void erase_slot(size_t slot)
+        {
+            std::destroy_at(slots_ + slot);
+            --size_;
+
+            // a group that still has an empty slot has never stopped a probe from moving on,
+            // so no probe sequence depends on this slot - it may become empty instead of a tombstone
+            if (detail::match_empty(load_group(slot / group_width)) != 0)
+            {
+                ctrl_[slot] = empty;
+                ++growth_left_;
+            }
+            else
+                ctrl_[slot] = deleted;
+        }
+
+        static void destroy_entries(Arrays* arrays)
+        {
+            for (size_t slot = 0; slot < arrays->capacity; ++slot)
+                if (is_full(arrays->ctrl()[slot]))
+                    std::destroy_at(arrays->slots() + slot);
+        }
+
+        Arrays* take_spare(size_t capacity)
+        {
+            for (Arrays** spare = &spares_; *spare != nullptr; spare = &(*spare)->next_spare)
+            {
+                if ((*spare)->capacity == capacity)
+                {
+                    Arrays* arrays = *spare;
+                    *spare = arrays->next_spare;
+                    return arrays;
+                }
+            }
+
+            return Arrays::allocate(capacity);
+        }
+
+        // new arrays of the given capacity - also drops the tombstones of deleted entries
+        void rehash(size_t capacity, const Hash& hasher)
+        {
+            Arrays* old = arrays_.load(std::memory_order_relaxed);
+
+            Arrays* arrays = optimistic_reads ? take_spare(capacity) : Arrays::allocate(capacity);
+            std::fill_n(arrays->ctrl(), capacity, empty);
+            ctrl_ = arrays->ctrl();
+            slots_ = arrays->slots();
+            capacity_ = capacity;
+            size_ = 0;
+            growth_left_ = capacity - capacity / 8;
+
+            if (old != nullptr)
+            {
+                for (size_t slot = 0; slot < old->capacity; ++slot)
+                {
+                    if (is_full(old->ctrl()[slot]))
+                    {
+                        const size_t hash = hasher(old->slots()[slot].first);
+                        construct_at(find_free_slot(hash), hash, std::move(old->slots()[slot]));
+                    }
+                }
+            }
+
+            arrays_.store(arrays, std::memory_order_release);
+
+            if (old != nullptr)
+            {
+                destroy_entries(old);
+                if (optimistic_reads)
+                {
+                    old->next_spare = spares_;
+                    spares_ = old;
+                }
+                else
+                    Arrays::deallocate(old);
+            }
+        }
+
+    public:
+        Bucket() = default;
+
+        Bucket(const Bucket&) = delete;
+        Bucket& operator=(const Bucket&) = delete;
+
+        ~Bucket()
+        {
+            if (Arrays* arrays = arrays_.load(std::memory_order_relaxed))
+            {
+                destroy_entries(arrays);
+                Arrays::deallocate(arrays);
+            }
+
+            while (spares_ != nullptr)
+                Arrays::deallocate(std::exchange(spares_, spares_->next_spare));
+        }
+
+        template <typename K>
+        const Value* find(const K& key, size_t hash) const
+        {
+            const size_t slot = find_slot(key, hash);
+            return (slot == npos) ? nullptr : &slots_[slot].second;
+        }
+
+        // may run concurrently with writers of the bucket and see a torn state - the caller must validate the result
+        // (seqlock); only reads memory owned by the bucket, copies the candidate key and the value
+        template <typename K>
+        LOOKUP_TABLE_NO_SANITIZE_THREAD bool find_optimistic(const K& key, size_t hash, Value& value) const
+        {
+            static_assert(optimistic_reads && is_plain_key<K>, "optimistic reads need plain keys and trivially copyable values");
+
+            Arrays* arrays = arrays_.load(std::memory_order_acquire);
+            if (arrays == nullptr)
+                return false;
+
+            const uint8_t fragment = h2(hash);
+            const uint8_t* ctrl = arrays->ctrl();
+            const bucket_value* slots = arrays->slots();
+            const size_t groups_mask = arrays->capacity / group_width - 1;
+            size_t group = h1(hash) & groups_mask;
+
+            for (size_t step = 1; step <= groups_mask + 1; ++step)
+            {
+                uint64_t word = 0;
+                for (size_t i = 0; i < group_width; ++i)
+                    word |= uint64_t{ctrl[group * group_width + i]} << (8 * i);
+
+                for (uint64_t match = detail::match_byte(word, fragment); match != 0; match &= match - 1)
+                {
+                    const bucket_value* entry = slots + group * group_width + detail::lowest_byte(match);
+
+                    Key candidate;
+                    std::memcpy(&candidate, &entry->first, sizeof(Key));
+                    if (EqualTo{}(candidate, key))
+                    {
+                        std::memcpy(&value, &entry->second, sizeof(Value));
+                        return true;
+                    }
+                }
+
+                if (detail::match_empty(word) != 0)
+                    return false;
+
+                group = (group + step) & groups_mask;
+            }
+
+            return false;
+        }
+
+        // returns true if the key was not there
+        template <typename K, typename V>
+        bool insert_or_assign(const K& key, size_t hash, V&& value, const Hash& hasher)
+        {
+            const size_t slot = find_slot(key, hash);
+            if (slot != npos)
+            {
+                slots_[slot].second = std::forward<V>(value);
+                return false;
+            }
+
+            emplace_new(hash, hasher, key, std::forward<V>(value));
+            return true;
+        }
+
+        // returns true if the key was not there
+        template <typename K, typename... Args>
+        bool try_emplace(const K& key, size_t hash, const Hash& hasher, Args&&... args)
+        {
+            if (find_slot(key, hash) != npos)
+                return false;
+
+            emplace_new(hash, hasher, std::piecewise_construct, std::forward_as_tuple(key), std::forward_as_tuple(std::forward<Args>(args)...));
+            return true;
+        }
+
+        // returns false if the key is not there
+        template <typename K, typename F>
+        bool update(const K& key, size_t hash, F&& f)
+        {
+            const size_t slot = find_slot(key, hash);
+            if (slot == npos)
+                return false;
+
+            std::forward<F>(f)(slots_[slot].second);
+            return true;
+        }
+
+        template <typename K>
+        bool erase(const K& key, size_t hash)
+        {
+            const size_t slot = find_slot(key, hash);
+            if (slot == npos)
+                return false;
+
+            erase_slot(slot);
+            return true;
+        }
+
+        // the first group of the probe sequence - control bytes and the slots' beginning
+        void prefetch(size_t hash) const
+        {
+            if (capacity_ == 0)
+                return;
+
+            const size_t group = h1(hash) & (capacity_ / group_width - 1);
+            detail::prefetch(ctrl_ + group * group_width);
+            detail::prefetch(slots_ + group * group_width);
+        }
+
+        // moves entries for which predicate(key, hash) holds to the target
+        template <typename Predicate>
+        void move_if(Bucket& target, Predicate predicate, const Hash& hasher)
+        {
+            for (size_t slot = 0; slot < capacity_; ++slot)
+            {
+                if (!is_full(ctrl_[slot]))
+                    continue;
+
+                const size_t hash = hasher(slots_[slot].first);
+                if (predicate(slots_[slot].first, hash))
+                {
+                    target.emplace_new(hash, hasher, std::move(slots_[slot]));
+                    erase_slot(slot);
+                }
+            }
+        }
+
+        size_t size() const
+        {
+            return size_;
+        }
+    };
+};
+
+// singly linked list of nodes that are never modified once published, for readers that take no lock: writers
+// (still serialized by the table's stripe lock) link nodes with atomic pointers and replace a node to update it;
+// unlinked nodes are retired to EpochDomain::global(), which readers pin while they walk the list
+struct EpochListStorage
+{
+    static constexpr float default_max_load_factor = 1.0f;
+
+    template <typename Key, typename Value, typename Hash, typename EqualTo>
+    class Bucket
+    {
+    public:
+        static constexpr bool optimistic_reads = false;
+        static constexpr bool lock_free_reads = true;
+
+    private:
+        struct Node
+        {
+            Key key;
+            Value value;
+            std::atomic<Node*> next {nullptr};
+        };
+
+        std::atomic<Node*> head_ {nullptr};
+        size_t size_ = 0;
+
+        // the link to the node with the key, or the null link at the end of the list
+        template <typename K>
+        std::atomic<Node*>* find_link(const K& key)
+        {
+            std::atomic<Node*>* link = &head_;
+            for (Node* node; (node = link->load(std::memory_order_relaxed)) != nullptr; link = &node->next)
+            {
+                if (EqualTo{}(node->key, key))
+                    break;
+            }
+
+            return link;
+        }
+
+        // at the null link at the end of the list
+        void append(std::atomic<Node*>* link, Node* node)
+        {
+            link->store(node, std::memory_order_release);
+            ++size_;
+        }
+
+        // a reader may be copying the old value - nodes are replaced instead of assigned to
+        void replace(std::atomic<Node*>* link, Node* old, Node* node)
+        {
+            node->next.store(old->next.load(std::memory_order_relaxed), std::memory_order_relaxed);
+            link->store(node, std::memory_order_release);
+            EpochDomain::global().retire(old);
+        }
+
+        // readers may still walk through the node - it stays linked to its successor until they are gone
+        void unlink(std::atomic<Node*>* link, Node* node)
+        {
+            link->store(node->next.load(std::memory_order_relaxed), std::memory_order_release);
+            EpochDomain::global().retire(node);
+            --size_;
+        }
+
+    public:
+        Bucket() = default;
+
+        Bucket(const Bucket&) = delete;
+        Bucket& operator=(const Bucket&) = delete;
+
+        ~Bucket()
+        {
+            for (Node* node = head_.load(); node != nullptr;)
+                delete std::exchange(node, node->next.load());
+        }
+
+        template <typename K>
+        const Value* find(const K& key, size_t /*hash*/) const
+        {
+            for (const Node* node = head_.load(std::memory_order_relaxed); node != nullptr; node = node->next.load(std::memory_order_relaxed))
+            {
+                if (EqualTo{}(node->key, key))
+                    return &node->value;
+            }
+
+            return nullptr;
+        }
+
+        // the caller holds an EpochDomain::Guard of the global domain instead of a lock
+        template <typename K>
+        std::optional<Value> find_lock_free(const K& key, size_t /*hash*/) const
+        {
+            for (const Node* node = head_.load(std::memory_order_acquire); node != nullptr; node = node->next.load(std::memory_order_acquire))
+            {
+                if (EqualTo{}(node->key, key))
+                    return node->value;
+            }
+
+            return std::nullopt;
+        }
+
+        // returns true if the key was not there
+        template <typename K, typename V>
+        bool insert_or_assign(const K& key, size_t /*hash*/, V&& value, const Hash& /*hasher*/)
+        {
+            std::atomic<Node*>* link = find_link(key);
+            Node* old = link->load(std::memory_order_relaxed);
+
+            if (old == nullptr)
+            {
+                append(link, new Node{Key(key), Value(std::forward<V>(value))});
+                return true;
+            }
+
+            replace(link, old, new Node{old->key, Value(std::forward<V>(value))}); // a copy of the stored key - key may be of another type
+            return false;
+        }
+
+        // returns true if the key was not there
+        template <typename K, typename... Args>
+        bool try_emplace(const K& key, size_t /*hash*/, const Hash& /*hasher*/, Args&&... args)
+        {
+            std::atomic<Node*>* link = find_link(key);
+            if (link->load(std::memory_order_relaxed) != nullptr)
+                return false;
+
+            append(link, new Node{Key(key), Value(std::forward<Args>(args)...)});
+            return true;
+        }
+
+        // returns false if the key is not there; f modifies a copy of the value in a new node
+        template <typename K, typename F>
+        bool update(const K& key, size_t /*hash*/, F&& f)
+        {
+            std::atomic<Node*>* link = find_link(key);
+            Node* old = link->load(std::memory_order_relaxed);
+            if (old == nullptr)
+                return false;
+
+            std::unique_ptr<Node> node {new Node{old->key, old->value}};
+            std::forward<F>(f)(node->value);
+            replace(link, old, node.release());
+            return true;
+        }
+
+        template <typename K>
+        bool erase(const K& key, size_t /*hash*/)
+        {
+            std::atomic<Node*>* link = find_link(key);
+            Node* node = link->load(std::memory_order_relaxed);
+            if (node == nullptr)
+                return false;
+
+            unlink(link, node);
+            return true;
+        }
+
+        void prefetch(size_t /*hash*/) const
+        {
+            if (const Node* head = head_.load(std::memory_order_relaxed))
+                detail::prefetch(head);
+        }
+
+        // a split in two steps - a reader that missed an entry in this bucket after erase_if() sees the grown
+        // bucket count, and the table publishes it only after copy_if() has filled the target
+        template <typename Predicate>
+        void copy_if(Bucket& target, Predicate predicate, const Hash& hasher) const
+        {
+            for (const Node* node = head_.load(std::memory_order_relaxed); node != nullptr; node = node->next.load(std::memory_order_relaxed))
+            {
+                if (predicate(node->key, hasher(node->key)))
+                    target.insert_or_assign(node->key, 0, node->value, hasher);
+            }
+        }
+
+        template <typename Predicate>
+        void erase_if(Predicate predicate, const Hash& hasher)
+        {
+            for (std::atomic<Node*>* link = &head_; Node* node = link->load(std::memory_order_relaxed);)
+            {
+                if (predicate(node->key, hasher(node->key)))
+                    unlink(link, node);
+                else
+                    link = &node->next;
+            }
+        }
+
+        size_t size() const
+        {
+            return size_;
+        }
+    };
+};
+
+#endif // LOOKUP_TABLE_STORAGE_HPP
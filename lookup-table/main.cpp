@@ -1,11 +1,26 @@
 #include "thread_safe_lookup_table.hpp"
 
+#include <algorithm>
 #include <iostream>
+#include <optional>
 #include <string>
+#include <string_view>
 #include <thread>
+#include <vector>
 
 using namespace std;
 
+// hashes std::string, std::string_view and const char* alike - with std::equal_to<> lookups need no std::string
+struct StringHash
+{
+    using is_transparent = void;
+
+    size_t operator()(std::string_view text) const
+    {
+        return std::hash<std::string_view>{}(text);
+    }
+};
+
 int main()
 {
     cout << "lookup-table" << endl;
@@ -51,4 +66,86 @@ int main()
     thd_write.join();
     thd_reader1.join();
     thd_reader2.join();
+
+    // entries in contiguous arrays instead of linked lists
+    ThreadSafeLookupTable<int, std::string, std::hash<int>, std::equal_to<int>, FlatStorage> flat_table;
+
+    for (int i = 0; i < 1000; ++i)
+        flat_table.add_or_update_mapping(i, "item_"s + std::to_string(i));
+
+    for (int i = 0; i < 1000; i += 2)
+        flat_table.remove_mapping(i);
+
+    std::cout << "flat 41: " << flat_table.value_for(41) << ", flat 42: " << flat_table.value_for(42, "<removed>") << std::endl;
+    std::cout << "flat table: " << flat_table.size() << " items in " << flat_table.bucket_count() << " buckets" << std::endl;
+
+    // plain keys and trivially copyable values - readers validate with a sequence number instead of locking
+    ThreadSafeLookupTable<int, double, std::hash<int>, std::equal_to<int>, FlatStorage> prices;
+
+    std::thread thd_pricer {[&prices]()
+        {
+            for (int round = 1; round <= 100; ++round)
+                for (int id = 0; id < 100; ++id)
+                    prices.add_or_update_mapping(id, id * 1.5 + round);
+        }
+    };
+
+    double total = 0.0;
+    for (int id = 0; id < 100; ++id)
+        total += prices.value_for(id);
+
+    thd_pricer.join();
+    std::cout << "prices: " << total << " seen while updating, " << prices.value_for(99) << " for 99 in the end" << std::endl;
+
+    // readers take no lock and never wait for writers - replaced nodes are reclaimed by epochs
+    ThreadSafeLookupTable<std::string, std::string, std::hash<std::string>, std::equal_to<std::string>, EpochListStorage> config;
+    config.add_or_update_mapping("mode", "fast");
+
+    std::thread thd_config_writer {[&config]()
+        {
+            for (int i = 0; i < 1000; ++i)
+                config.add_or_update_mapping("mode", i % 2 ? "safe" : "fast");
+        }
+    };
+
+    size_t fast_reads = 0;
+    for (int i = 0; i < 1000; ++i)
+        fast_reads += (config.value_for("mode") == "fast");
+
+    thd_config_writer.join();
+    std::cout << "config: " << fast_reads << " of 1000 reads saw 'fast'" << std::endl;
+
+    // heterogeneous lookup - the keys of the requests are views into a buffer, no std::string is built for them
+    ThreadSafeLookupTable<std::string, int, StringHash, std::equal_to<>> hits;
+    const std::string_view requests = "GET /index GET /about GET /index POST /login GET /index";
+
+    for (size_t begin = 0; begin < requests.size();)
+    {
+        const size_t end = std::min(requests.find(' ', requests.find(' ', begin) + 1), requests.size());
+        const std::string_view request = requests.substr(begin, end - begin);
+
+        hits.compute(request, [](const int* count) { return std::optional<int>{count ? *count + 1 : 1}; }); // atomic increment
+        begin = end + 1;
+    }
+
+    hits.remove_mapping("POST /login");
+    std::cout << "hits: " << hits.value_for("GET /index") << " for /index, " << hits.size() << " distinct requests" << std::endl;
+
+    // large values are read and modified in place under the lock instead of being copied out and back in
+    ThreadSafeLookupTable<std::string, std::vector<int>, StringHash, std::equal_to<>> histories;
+    histories.try_emplace("sensor", 1000, 0);
+    histories.update("sensor", [](std::vector<int>& history) { history.push_back(42); });
+
+    size_t samples = 0;
+    histories.visit("sensor", [&samples](const std::vector<int>& history) { samples = history.size(); });
+    std::cout << "sensor: " << samples << " samples" << std::endl;
+
+    // a batch of lookups locks each stripe once instead of once per key
+    const std::vector<int> ids {1, 7, 42, 500, 999, 5000};
+    std::vector<std::string> names;
+    const size_t found_names = lookup_table.multi_get(ids, names, "<unknown>");
+    std::cout << "batch: " << found_names << " of " << ids.size() << " found, 5000: " << names.back() << std::endl;
+
+    lookup_table.multi_put(std::vector<std::pair<int, std::string>> {{5000, "five thousand"}, {5001, "five thousand one"}});
+    std::cout << "5000: " << lookup_table.value_for(5000) << std::endl;
 }
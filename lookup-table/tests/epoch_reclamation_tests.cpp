@@ -0,0 +1,130 @@
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "epoch_reclamation.hpp"
+#include "thread_safe_lookup_table.hpp"
+
+using namespace std;
+
+namespace
+{
+    struct Tracked
+    {
+        atomic<int>& freed;
+
+        ~Tracked()
+        {
+            ++freed;
+        }
+    };
+}
+
+TEST_CASE("EpochDomain")
+{
+    EpochDomain domain;
+    atomic<int> freed {0};
+
+    SECTION("a retired object is freed once the epoch has advanced twice")
+    {
+        domain.retire(new Tracked {freed});
+
+        domain.collect();
+        REQUIRE(freed == 0);
+
+        domain.collect();
+        REQUIRE(freed == 1);
+    }
+
+    SECTION("a guard keeps objects retired while it is alive")
+    {
+        {
+            EpochDomain::Guard guard {domain};
+            domain.retire(new Tracked {freed});
+
+            for (int i = 0; i < 10; ++i)
+                domain.collect();
+            REQUIRE(freed == 0);
+        }
+
+        domain.collect();
+        domain.collect();
+        REQUIRE(freed == 1);
+    }
+
+    SECTION("a guard of another domain does not hold the objects back")
+    {
+        EpochDomain other;
+        EpochDomain::Guard guard {other};
+
+        domain.retire(new Tracked {freed});
+        domain.collect();
+        domain.collect();
+
+        REQUIRE(freed == 1);
+    }
+
+    SECTION("retirements collect on their own")
+    {
+        for (int i = 0; i < 1000; ++i)
+            domain.retire(new Tracked {freed});
+
+        REQUIRE(freed > 0);
+    }
+
+    SECTION("the domain frees what is left when destroyed")
+    {
+        {
+            EpochDomain short_lived;
+            short_lived.retire(new Tracked {freed});
+        }
+
+        REQUIRE(freed == 1);
+    }
+}
+
+TEST_CASE("EpochListStorage - lock-free readers while writers replace and unlink nodes")
+{
+    ThreadSafeLookupTable<int, string, std::hash<int>, std::equal_to<int>, EpochListStorage> table;
+
+    const int key_count = 1000;
+    auto value_of = [](int key, int round) { return string(64, static_cast<char>('a' + (key + round) % 26)); };
+
+    for (int i = 0; i < key_count; ++i)
+        table.add_or_update_mapping(i, value_of(i, 0));
+
+    atomic<bool> writing {true};
+    atomic<int> corrupted {0};
+
+    vector<thread> readers;
+    for (int r = 0; r < 4; ++r)
+        readers.emplace_back([&] {
+            while (writing)
+                for (int i = 0; i < key_count; ++i)
+                {
+                    const string value = table.value_for(i);
+                    if (!value.empty() && value != string(64, value[0]))
+                        ++corrupted;
+                }
+        });
+
+    for (int round = 1; round < 50; ++round)
+        for (int i = 0; i < key_count; ++i)
+        {
+            if ((i + round) % 3 == 0)
+                table.remove_mapping(i);
+            else
+                table.add_or_update_mapping(i, value_of(i, round));
+        }
+    writing = false;
+
+    for (auto& reader : readers)
+        reader.join();
+
+    REQUIRE(corrupted == 0);
+    for (int i = 0; i < key_count; ++i)
+        REQUIRE(table.value_for(i) == ((i + 49) % 3 == 0 ? "" : value_of(i, 49)));
+}
@@ -0,0 +1,81 @@
+#include <string>
+
+#include "catch.hpp"
+
+#include "thread_safe_lookup_table.hpp"
+
+using namespace std;
+
+namespace
+{
+    // one bucket that never splits - every entry goes through the same bucket of the storage
+    template <typename Key, typename Value, typename Storage>
+    struct SingleBucketTable : ThreadSafeLookupTable<Key, Value, std::hash<Key>, std::equal_to<Key>, Storage>
+    {
+        SingleBucketTable()
+            : ThreadSafeLookupTable<Key, Value, std::hash<Key>, std::equal_to<Key>, Storage>(1, std::hash<Key> {}, 1)
+        {
+            this->max_load_factor(1'000'000.0f);
+        }
+    };
+}
+
+TEMPLATE_TEST_CASE("Storage - a crowded bucket", "", ListStorage, FlatStorage, EpochListStorage)
+{
+    SingleBucketTable<int, int, TestType> table;
+
+    for (int i = 0; i < 1000; ++i)
+        table.add_or_update_mapping(i, i);
+
+    REQUIRE(table.bucket_count() == 1);
+    REQUIRE(table.size() == 1000);
+
+    SECTION("finds every entry after it grows")
+    {
+        for (int i = 0; i < 1000; ++i)
+            REQUIRE(table.value_for(i, -1) == i);
+        REQUIRE(table.value_for(1000, -1) == -1);
+    }
+
+    SECTION("erased entries are gone, the others stay")
+    {
+        for (int i = 0; i < 1000; i += 2)
+            table.remove_mapping(i);
+
+        REQUIRE(table.size() == 500);
+        for (int i = 0; i < 1000; ++i)
+            REQUIRE(table.value_for(i, -1) == (i % 2 == 0 ? -1 : i));
+    }
+
+    SECTION("slots freed by erasures are reused")
+    {
+        for (int round = 0; round < 20; ++round)
+        {
+            for (int i = 0; i < 1000; i += 2)
+                table.remove_mapping(i);
+            for (int i = 0; i < 1000; i += 2)
+                table.add_or_update_mapping(i, i + round);
+        }
+
+        REQUIRE(table.size() == 1000);
+        for (int i = 0; i < 1000; ++i)
+            REQUIRE(table.value_for(i, -1) == (i % 2 == 0 ? i + 19 : i));
+    }
+}
+
+TEMPLATE_TEST_CASE("Storage - non-trivial keys and values", "", ListStorage, FlatStorage, EpochListStorage)
+{
+    SingleBucketTable<string, string, TestType> table;
+
+    for (int i = 0; i < 100; ++i)
+        table.add_or_update_mapping("key" + to_string(i), string(100, static_cast<char>('a' + i % 26)));
+
+    for (int i = 0; i < 100; i += 3)
+        table.remove_mapping("key" + to_string(i));
+
+    for (int i = 0; i < 100; ++i)
+    {
+        const string expected = (i % 3 == 0) ? "" : string(100, static_cast<char>('a' + i % 26));
+        REQUIRE(table.value_for("key" + to_string(i)) == expected);
+    }
+}
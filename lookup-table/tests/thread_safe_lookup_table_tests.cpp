@@ -0,0 +1,635 @@
+#include <atomic>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "catch.hpp"
+
+#include "thread_safe_lookup_table.hpp"
+
+using namespace std;
+using namespace std::literals;
+
+namespace
+{
+    const int writer_count = 8;
+
+    // inserts estimate the load from their own stripe, so the table may get a little past its maximum
+    const float load_factor_tolerance = 1.01f;
+
+    // runs f(thread_index) on count threads and joins them
+    template <typename F>
+    void run_concurrently(int count, F f)
+    {
+        vector<thread> threads;
+        for (int i = 0; i < count; ++i)
+            threads.emplace_back(f, i);
+        for (auto& thd : threads)
+            thd.join();
+    }
+
+    // trivially copyable and wider than a word - a torn read shows as halves that differ
+    struct Twin
+    {
+        int64_t first;
+        int64_t second;
+    };
+
+    // counts the keys built from text - a lookup by std::string_view must not build any (EpochListStorage
+    // copies the stored key into the node that replaces an updated one)
+    struct CountedKey
+    {
+        static inline atomic<int> built_from_text {0};
+
+        string text;
+
+        explicit CountedKey(string_view text)
+            : text{text}
+        {
+            ++built_from_text;
+        }
+
+        friend bool operator==(const CountedKey& a, const CountedKey& b) { return a.text == b.text; }
+        friend bool operator==(const CountedKey& a, string_view b) { return a.text == b; }
+        friend bool operator==(string_view a, const CountedKey& b) { return a == b.text; }
+    };
+
+    // counts its copies - moves and in-place construction are free
+    struct CopyCounted
+    {
+        static inline atomic<int> copies {0};
+
+        int value = 0;
+
+        CopyCounted() = default;
+
+        explicit CopyCounted(int value)
+            : value{value}
+        {
+        }
+
+        CopyCounted(const CopyCounted& other)
+            : value{other.value}
+        {
+            ++copies;
+        }
+
+        CopyCounted(CopyCounted&&) = default;
+
+        CopyCounted& operator=(const CopyCounted& other)
+        {
+            value = other.value;
+            ++copies;
+            return *this;
+        }
+
+        CopyCounted& operator=(CopyCounted&&) = default;
+    };
+
+    struct TextHash
+    {
+        using is_transparent = void;
+
+        size_t operator()(string_view text) const
+        {
+            return std::hash<string_view>{}(text);
+        }
+
+        size_t operator()(const CountedKey& key) const
+        {
+            return (*this)(string_view{key.text});
+        }
+    };
+}
+
+TEMPLATE_TEST_CASE("ThreadSafeLookupTable - rehashing", "", ListStorage, FlatStorage, EpochListStorage)
+{
+    ThreadSafeLookupTable<int, int, std::hash<int>, std::equal_to<int>, TestType> table;
+    table.max_load_factor(1.0f);
+
+    SECTION("grows as entries are added and keeps every one of them")
+    {
+        const size_t initial_bucket_count = table.bucket_count();
+
+        for (int i = 0; i < 10'000; ++i)
+            table.add_or_update_mapping(i, i * 2);
+
+        REQUIRE(table.size() == 10'000);
+        REQUIRE(table.bucket_count() > initial_bucket_count);
+        REQUIRE(table.load_factor() <= table.max_load_factor() * load_factor_tolerance);
+
+        for (int i = 0; i < 10'000; ++i)
+            REQUIRE(table.value_for(i, -1) == i * 2);
+    }
+
+    SECTION("concurrent writers keep the load factor bounded")
+    {
+        const int n = 200'000;
+
+        run_concurrently(writer_count, [&](int w) {
+            for (int i = w; i < n; i += writer_count)
+                table.add_or_update_mapping(i, i);
+        });
+
+        REQUIRE(table.size() == n);
+        REQUIRE(table.load_factor() <= table.max_load_factor() * load_factor_tolerance);
+
+        for (int i = 0; i < n; ++i)
+            REQUIRE(table.value_for(i, -1) == i);
+    }
+
+    SECTION("readers find existing entries while writers split buckets")
+    {
+        const int n = 100'000;
+        for (int i = 0; i < 1000; ++i)
+            table.add_or_update_mapping(-i - 1, i);
+
+        atomic<bool> writing {true};
+        atomic<int> misses {0};
+
+        run_concurrently(writer_count, [&](int w) {
+            if (w % 2 == 0)
+            {
+                for (int i = w; i < n; i += writer_count)
+                    table.add_or_update_mapping(i, i);
+                writing = false;
+            }
+            else
+            {
+                while (writing)
+                    for (int i = 0; i < 1000; ++i)
+                        if (table.value_for(-i - 1, -1) != i)
+                            ++misses;
+            }
+        });
+
+        REQUIRE(misses == 0);
+    }
+
+    SECTION("removals while other writers split buckets")
+    {
+        const int n = 100'000;
+        for (int i = 0; i < n; ++i)
+            table.add_or_update_mapping(-i - 1, i);
+
+        run_concurrently(writer_count, [&](int w) {
+            if (w % 2 == 0)
+            {
+                for (int i = w / 2; i < n; i += writer_count / 2)
+                    table.add_or_update_mapping(i, i);
+            }
+            else
+            {
+                for (int i = w / 2; i < n; i += writer_count / 2)
+                    table.remove_mapping(-i - 1);
+            }
+        });
+
+        REQUIRE(table.size() == n);
+        REQUIRE(table.load_factor() <= table.max_load_factor() * load_factor_tolerance);
+        for (int i = 0; i < n; ++i)
+        {
+            REQUIRE(table.value_for(i, -1) == i);
+            REQUIRE(table.value_for(-i - 1, -1) == -1);
+        }
+    }
+
+    SECTION("concurrent removals leave exactly the other entries")
+    {
+        const int n = 100'000;
+        for (int i = 0; i < n; ++i)
+            table.add_or_update_mapping(i, i);
+
+        atomic<int> misses {0};
+
+        run_concurrently(writer_count, [&](int w) {
+            for (int i = 2 * w; i < n; i += 2 * writer_count)
+            {
+                table.remove_mapping(i);
+                if (table.value_for(i + 1, -1) != i + 1)
+                    ++misses;
+            }
+        });
+
+        REQUIRE(misses == 0);
+        REQUIRE(table.size() == n / 2);
+        for (int i = 0; i < n; ++i)
+            REQUIRE(table.value_for(i, -1) == (i % 2 == 0 ? -1 : i));
+    }
+}
+
+TEST_CASE("ThreadSafeLookupTable - lock stripes")
+{
+    SECTION("the stripe count is rounded up to a power of 2 and the bucket count to a multiple of it")
+    {
+        ThreadSafeLookupTable<int, int> table {19, std::hash<int> {}, 12};
+
+        REQUIRE(table.stripe_count() == 16);
+        REQUIRE(table.bucket_count() == 32);
+    }
+
+    SECTION("the stripe count stays fixed while the buckets grow")
+    {
+        ThreadSafeLookupTable<int, int> table {8, std::hash<int> {}, 8};
+        table.max_load_factor(1.0f);
+
+        for (int i = 0; i < 10'000; ++i)
+            table.add_or_update_mapping(i, i);
+
+        REQUIRE(table.stripe_count() == 8);
+        REQUIRE(table.bucket_count() >= 10'000);
+        for (int i = 0; i < 10'000; ++i)
+            REQUIRE(table.value_for(i, -1) == i);
+    }
+
+    SECTION("a single stripe guards all the buckets")
+    {
+        ThreadSafeLookupTable<int, int> table {1, std::hash<int> {}, 1};
+        table.max_load_factor(1.0f);
+        const int n = 50'000;
+
+        run_concurrently(writer_count, [&](int w) {
+            for (int i = w; i < n; i += writer_count)
+                table.add_or_update_mapping(i, i);
+        });
+
+        REQUIRE(table.stripe_count() == 1);
+        REQUIRE(table.size() == n);
+        REQUIRE(table.load_factor() <= table.max_load_factor() * load_factor_tolerance);
+        for (int i = 0; i < n; ++i)
+            REQUIRE(table.value_for(i, -1) == i);
+    }
+}
+
+TEST_CASE("ThreadSafeLookupTable - optimistic reads")
+{
+    SECTION("plain keys with trivially copyable values read optimistically, other keys take the lock")
+    {
+        STATIC_REQUIRE(FlatStorage::Bucket<int, Twin, std::hash<int>, std::equal_to<int>>::optimistic_reads);
+        STATIC_REQUIRE_FALSE(FlatStorage::Bucket<string, int, std::hash<string>, std::equal_to<string>>::optimistic_reads);
+        STATIC_REQUIRE_FALSE(FlatStorage::Bucket<int, string, std::hash<int>, std::equal_to<int>>::optimistic_reads);
+    }
+
+    SECTION("readers see only whole values written while writers update and split buckets")
+    {
+        ThreadSafeLookupTable<int, Twin, std::hash<int>, std::equal_to<int>, FlatStorage> table;
+        table.max_load_factor(1.0f);
+
+        const int key_count = 1000;
+        for (int i = 0; i < key_count; ++i)
+            table.add_or_update_mapping(i, Twin {i, i});
+
+        atomic<int> writers_left {writer_count / 2};
+        atomic<int> torn {0};
+        atomic<int> misses {0};
+
+        run_concurrently(writer_count, [&](int w) {
+            if (w % 2 == 0)
+            {
+                for (int round = 1; round < 100; ++round)
+                {
+                    for (int i = w / 2; i < key_count; i += writer_count / 2)
+                        table.add_or_update_mapping(i, Twin {round * key_count + i, round * key_count + i});
+                    for (int i = 0; i < 100; ++i) // new keys keep splitting buckets
+                        table.add_or_update_mapping(key_count * (round * writer_count + w + 1) + i, Twin {});
+                }
+                --writers_left;
+            }
+            else
+            {
+                while (writers_left > 0)
+                    for (int i = 0; i < key_count; ++i)
+                    {
+                        const Twin value = table.value_for(i, Twin {-1, -1});
+                        if (value.first != value.second)
+                            ++torn;
+                        else if (value.first % key_count != i)
+                            ++misses;
+                    }
+            }
+        });
+
+        REQUIRE(torn == 0);
+        REQUIRE(misses == 0);
+        for (int i = 0; i < key_count; ++i)
+            REQUIRE(table.value_for(i, Twin {}).first == 99 * key_count + i);
+    }
+
+    SECTION("string keys fall back to the shared lock while writers run")
+    {
+        ThreadSafeLookupTable<string, int, std::hash<string>, std::equal_to<string>, FlatStorage> table;
+
+        for (int i = 0; i < 100; ++i)
+            table.add_or_update_mapping(to_string(i), i);
+
+        atomic<bool> writing {true};
+        atomic<int> misses {0};
+
+        run_concurrently(2, [&](int w) {
+            if (w == 0)
+            {
+                for (int i = 100; i < 20'000; ++i)
+                    table.add_or_update_mapping(to_string(i), i);
+                writing = false;
+            }
+            else
+            {
+                while (writing)
+                    for (int i = 0; i < 100; ++i)
+                        if (table.value_for(to_string(i), -1) != i)
+                            ++misses;
+            }
+        });
+
+        REQUIRE(misses == 0);
+    }
+}
+
+TEMPLATE_TEST_CASE("ThreadSafeLookupTable - heterogeneous lookup", "", ListStorage, FlatStorage, EpochListStorage)
+{
+    SECTION("std::string keys are found, changed and removed by std::string_view")
+    {
+        ThreadSafeLookupTable<string, int, TextHash, std::equal_to<>, TestType> table;
+        table.add_or_update_mapping("one"s, 1);
+
+        const string_view one = "one";
+        REQUIRE(table.value_for(one, -1) == 1);
+        REQUIRE(table.value_for("two"sv, -1) == -1);
+
+        table.add_or_update_mapping(one, 11);
+        REQUIRE(table.value_for("one"s, -1) == 11);
+
+        table.add_or_update_mapping("two"sv, 2);
+        REQUIRE(table.size() == 2);
+        REQUIRE(table.value_for("two"s, -1) == 2);
+
+        table.remove_mapping(one);
+        REQUIRE(table.value_for("one"s, -1) == -1);
+        REQUIRE(table.size() == 1);
+    }
+
+    SECTION("no key is built from the lookup key to look up, change or remove an entry")
+    {
+        ThreadSafeLookupTable<CountedKey, int, TextHash, std::equal_to<>, TestType> table;
+
+        const vector<string> texts {"alpha", "beta", "gamma", "delta"};
+        for (const string& text : texts)
+            table.add_or_update_mapping(string_view{text}, 1);
+
+        const int built_to_insert = CountedKey::built_from_text;
+
+        for (const string& text : texts)
+        {
+            const string_view key {text};
+
+            REQUIRE(table.value_for(key, 0) == 1);
+            table.add_or_update_mapping(key, 2);
+            REQUIRE(table.update(key, [](int& value) { ++value; }));
+            REQUIRE(table.visit(key, [](const int& value) { REQUIRE(value == 3); }));
+            REQUIRE(table.try_emplace(key, 4) == false);
+            REQUIRE(table.compute(key, [](const int* value) { return optional<int> {*value * 10}; }));
+            REQUIRE(table.value_for(key, 0) == 30);
+        }
+
+        const vector<string_view> keys {texts[0], "missing", texts[3]};
+        vector<int> values;
+        REQUIRE(table.multi_get(keys, values, 0) == 2);
+        REQUIRE(values == vector<int> {30, 0, 30});
+
+        for (const string& text : texts)
+            table.remove_mapping(string_view{text});
+
+        REQUIRE(table.size() == 0);
+        REQUIRE(CountedKey::built_from_text == built_to_insert);
+    }
+}
+
+TEMPLATE_TEST_CASE("ThreadSafeLookupTable - visitors and upserts", "", ListStorage, FlatStorage, EpochListStorage)
+{
+    ThreadSafeLookupTable<int, int, std::hash<int>, std::equal_to<int>, TestType> table;
+    table.add_or_update_mapping(1, 10);
+
+    SECTION("visit reads the value of a present key only")
+    {
+        int seen = 0;
+        REQUIRE(table.visit(1, [&](const int& value) { seen = value; }));
+        REQUIRE(seen == 10);
+
+        REQUIRE(table.visit(2, [&](const int&) { seen = -1; }) == false);
+        REQUIRE(seen == 10);
+    }
+
+    SECTION("update modifies the value of a present key only")
+    {
+        REQUIRE(table.update(1, [](int& value) { value += 5; }));
+        REQUIRE(table.value_for(1) == 15);
+
+        REQUIRE(table.update(2, [](int& value) { value = 0; }) == false);
+        REQUIRE(table.value_for(2, -1) == -1);
+        REQUIRE(table.size() == 1);
+    }
+
+    SECTION("try_emplace inserts only an absent key")
+    {
+        REQUIRE(table.try_emplace(1, 20) == false);
+        REQUIRE(table.value_for(1) == 10);
+
+        REQUIRE(table.try_emplace(2, 20));
+        REQUIRE(table.value_for(2) == 20);
+        REQUIRE(table.size() == 2);
+    }
+
+    SECTION("insert_or_assign tells an insertion from an assignment")
+    {
+        REQUIRE(table.insert_or_assign(1, 11) == false);
+        REQUIRE(table.insert_or_assign(2, 22));
+
+        REQUIRE(table.value_for(1) == 11);
+        REQUIRE(table.value_for(2) == 22);
+        REQUIRE(table.size() == 2);
+    }
+
+    SECTION("compute inserts, changes and removes an entry")
+    {
+        auto increment_or_start = [](const int* value) { return optional<int> {value == nullptr ? 1 : *value + 1}; };
+
+        REQUIRE(table.compute(2, increment_or_start));
+        REQUIRE(table.value_for(2) == 1);
+
+        REQUIRE(table.compute(1, increment_or_start));
+        REQUIRE(table.value_for(1) == 11);
+
+        REQUIRE(table.compute(1, [](const int*) { return optional<int> {}; }) == false);
+        REQUIRE(table.value_for(1, -1) == -1);
+        REQUIRE(table.size() == 1);
+
+        REQUIRE(table.compute(3, [](const int*) { return optional<int> {}; }) == false);
+        REQUIRE(table.size() == 1);
+    }
+
+    SECTION("concurrent updates of shared counters lose no increment")
+    {
+        const int counter_count = 16;
+        const int increments = 10'000;
+        for (int i = 0; i < counter_count; ++i)
+            table.add_or_update_mapping(i, 0);
+
+        run_concurrently(writer_count, [&](int w) {
+            for (int i = 0; i < increments; ++i)
+            {
+                const int key = (w + i) % counter_count;
+                if (i % 2 == 0)
+                    table.update(key, [](int& value) { ++value; });
+                else
+                    table.compute(key, [](const int* value) { return optional<int> {*value + 1}; });
+            }
+        });
+
+        int total = 0;
+        for (int i = 0; i < counter_count; ++i)
+            total += table.value_for(i);
+        REQUIRE(total == writer_count * increments);
+    }
+}
+
+TEMPLATE_TEST_CASE("ThreadSafeLookupTable - values are not copied", "", ListStorage, FlatStorage, EpochListStorage)
+{
+    ThreadSafeLookupTable<int, CopyCounted, std::hash<int>, std::equal_to<int>, TestType> table;
+    CopyCounted::copies = 0;
+
+    for (int i = 0; i < 1000; ++i) // rehashes on the way
+        REQUIRE(table.try_emplace(i, i));
+
+    // a split of EpochListStorage copies the entries it moves - readers may still walk the old nodes
+    if constexpr (!std::is_same_v<TestType, EpochListStorage>)
+        REQUIRE(CopyCounted::copies == 0);
+    CopyCounted::copies = 0;
+    table.max_load_factor(1'000'000.0f); // no more splits
+
+    REQUIRE(table.insert_or_assign(0, CopyCounted {-1}) == false);
+    REQUIRE(table.insert_or_assign(1000, CopyCounted {1000}));
+
+    int sum = 0;
+    for (int i = 0; i <= 1000; ++i)
+        REQUIRE(table.visit(i, [&](const CopyCounted& value) { sum += value.value; }));
+
+    REQUIRE(sum == 999 * 1000 / 2 - 1 + 1000);
+    REQUIRE(CopyCounted::copies == 0);
+}
+
+TEMPLATE_TEST_CASE("ThreadSafeLookupTable - batched lookups and updates", "", ListStorage, FlatStorage, EpochListStorage)
+{
+    ThreadSafeLookupTable<int, int, std::hash<int>, std::equal_to<int>, TestType> table;
+    table.max_load_factor(1.0f);
+
+    SECTION("multi_get matches value_for key by key and counts the keys found")
+    {
+        for (int i = 0; i < 1000; i += 2)
+            table.add_or_update_mapping(i, i * 3);
+
+        vector<int> keys;
+        for (int i = 999; i >= 0; --i)
+            keys.push_back(i);
+
+        vector<int> values {42}; // replaced
+        REQUIRE(table.multi_get(keys, values, -1) == 500);
+
+        REQUIRE(values.size() == keys.size());
+        for (size_t i = 0; i < keys.size(); ++i)
+            REQUIRE(values[i] == table.value_for(keys[i], -1));
+    }
+
+    SECTION("an empty batch")
+    {
+        vector<int> values {1, 2};
+        REQUIRE(table.multi_get(vector<int> {}, values) == 0);
+        REQUIRE(values.empty());
+
+        table.multi_put(vector<pair<int, int>> {});
+        REQUIRE(table.size() == 0);
+    }
+
+    SECTION("multi_put inserts and updates, the last of repeated keys wins")
+    {
+        table.add_or_update_mapping(1, 0);
+
+        const vector<pair<int, int>> pairs {{1, 10}, {2, 20}, {1, 11}, {3, 30}, {2, 21}, {1, 12}};
+        table.multi_put(pairs);
+
+        REQUIRE(table.size() == 3);
+        REQUIRE(table.value_for(1) == 12);
+        REQUIRE(table.value_for(2) == 21);
+        REQUIRE(table.value_for(3) == 30);
+    }
+
+    SECTION("multi_put grows the table like single inserts")
+    {
+        vector<pair<int, int>> pairs;
+        for (int i = 0; i < 10'000; ++i)
+            pairs.emplace_back(i, -i);
+
+        table.multi_put(pairs);
+
+        REQUIRE(table.size() == 10'000);
+        REQUIRE(table.load_factor() <= table.max_load_factor() * load_factor_tolerance);
+        for (int i = 0; i < 10'000; ++i)
+            REQUIRE(table.value_for(i, 1) == -i);
+    }
+
+    SECTION("batches of concurrent writers and readers while buckets split")
+    {
+        const int batch_size = 100;
+        const int batch_count = 100;
+        for (int i = 0; i < batch_size; ++i)
+            table.add_or_update_mapping(-i - 1, i);
+
+        atomic<int> writers_left {writer_count / 2};
+        atomic<int> misses {0};
+
+        run_concurrently(writer_count, [&](int w) {
+            if (w % 2 == 0)
+            {
+                for (int b = w / 2; b < batch_count; b += writer_count / 2)
+                {
+                    vector<pair<int, int>> pairs;
+                    for (int i = 0; i < batch_size; ++i)
+                        pairs.emplace_back(b * batch_size + i, b);
+                    table.multi_put(pairs);
+                }
+                --writers_left;
+            }
+            else
+            {
+                vector<int> keys;
+                for (int i = 0; i < batch_size; ++i)
+                    keys.push_back(-i - 1);
+
+                vector<int> values;
+                while (writers_left > 0)
+                {
+                    if (table.multi_get(keys, values, -1) != batch_size)
+                        ++misses;
+                    for (int i = 0; i < batch_size; ++i)
+                        if (values[i] != i)
+                            ++misses;
+                }
+            }
+        });
+
+        REQUIRE(misses == 0);
+        REQUIRE(table.size() == batch_size * (batch_count + 1));
+        REQUIRE(table.load_factor() <= table.max_load_factor() * load_factor_tolerance);
+
+        vector<int> keys;
+        for (int i = 0; i < batch_size * batch_count; ++i)
+            keys.push_back(i);
+
+        vector<int> values;
+        REQUIRE(table.multi_get(keys, values, -1) == batch_size * batch_count);
+        for (int i = 0; i < batch_size * batch_count; ++i)
+            REQUIRE(values[i] == i / batch_size);
+    }
+}
@@ -1,80 +1,449 @@
 #ifndef THREAD_SAFE_LOOKUP_TABLE_HPP
 #define THREAD_SAFE_LOOKUP_TABLE_HPP
 
+#include "lookup_table_storage.hpp"
+
+#include <array>
+#include <atomic>
 #include <cassert>
+#include <cstdint>
 #include <future>
+#include <iterator>
 #include <mutex>
+#include <optional>
 #include <shared_mutex>
 #include <thread>
+#include <type_traits>
+#include <utility>
 #include <vector>
-#include <list>
 #include <algorithm>
 
-template <typename Key, typename Value, typename Hash = std::hash<Key>, typename EqualTo = std::equal_to<Key>>
+// grows by linear hashing: when the load factor is exceeded, the writer that noticed it splits the next bucket
+// in line (and a few more), moving the entries that belong to the new bucket - or, if another writer is splitting,
+// leaves its splits to that one; there is no table-wide rehash,
+// a split locks just the stripe of the bucket being split, and buckets never move (segments of growing size);
+// locks are striped - bucket i is guarded by stripe i % stripe count, however many buckets there are;
+// with a storage that supports optimistic reads (FlatStorage of plain keys and trivially copyable values) value_for()
+// takes no lock at all unless writers keep interfering - it validates what it read with the stripe's sequence number;
+// with EpochListStorage readers never lock nor retry for writers - they pin an epoch (epoch_reclamation.hpp) instead;
+// with a transparent Hash and EqualTo (both declare is_transparent) keys of other types (std::string_view for
+// std::string) look up, update and remove entries without constructing a Key - a Key is built only to insert one
+
+namespace detail
+{
+    template <typename T, typename = void>
+    struct is_transparent : std::false_type
+    {
+    };
+
+    template <typename T>
+    struct is_transparent<T, std::void_t<typename T::is_transparent>> : std::true_type
+    {
+    };
+
+    // the table's hash - linear hashing takes it modulo the bucket count, so weak hashes (the identity of std::hash
+    // for integers and pointers) must be spread first, or strided keys would fill a fraction of the buckets
+    template <typename Hash>
+    struct MixedHash
+    {
+        Hash hash;
+
+        template <typename K>
+        size_t operator()(const K& key) const
+        {
+            return static_cast<size_t>(mix_hash(hash(key)));
+        }
+    };
+}
+
+template <typename Key, typename Value, typename Hash = std::hash<Key>, typename EqualTo = std::equal_to<Key>,
+    typename Storage = ListStorage>
 class ThreadSafeLookupTable
 {
 private:
-    class Bucket
+    using Bucket = typename Storage::template Bucket<Key, Value, detail::MixedHash<Hash>, EqualTo>;
+
+    // on its own cache line - writers of one stripe do not slow down readers of the neighbouring ones
+    struct alignas(64) Stripe
     {
+        mutable std::shared_mutex mutex;
+        std::atomic<size_t> size {0}; // entries in the buckets of the stripe; written under the unique lock
+        std::atomic<uint64_t> seq {0}; // odd while a writer modifies the buckets of the stripe
+    };
+
+    // a modification of the stripe's buckets (under its unique lock) - optimistic readers of the stripe retry
+    class WriteSection
+    {
+    public:
+        explicit WriteSection(Stripe& stripe)
+            : stripe_{stripe}
+        {
+            stripe_.seq.store(stripe_.seq.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+        }
+
+        WriteSection(const WriteSection&) = delete;
+        WriteSection& operator=(const WriteSection&) = delete;
+
+        ~WriteSection()
+        {
+            stripe_.seq.store(stripe_.seq.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+        }
+
     private:
-        using bucket_value = std::pair<Key, Value>;
-        using bucket_data = std::list<bucket_value>;
-        using bucket_iterator = typename bucket_data::iterator;
-        using bucket_const_iterator = typename bucket_data::const_iterator;
+        Stripe& stripe_;
+    };
+
+    template <typename Lock>
+    struct LockedBucket
+    {
+        Bucket& bucket;
+        Stripe& stripe;
+        Lock lock;
+    };
+
+    // segment 0 holds buckets [0, base), segment k > 0 holds [base * 2^(k-1), base * 2^k)
+    static constexpr size_t max_segments = 48;
+    static constexpr size_t splits_per_insert = 4; // the rehashing work one insert adds
+    static constexpr size_t optimistic_read_attempts = 4; // then value_for() falls back to the shared lock
+
+    const size_t stripe_count_; // a power of 2
+    const size_t base_count_;   // a multiple of stripe_count_ - a split never moves entries to another stripe
+    std::unique_ptr<Stripe[]> stripes_;
+    std::array<std::atomic<Bucket*>, max_segments> segments_ {};
+    std::atomic<size_t> bucket_count_;
+    std::atomic<float> max_load_factor_ {Storage::default_max_load_factor};
+    std::mutex mtx_split_;
+    std::atomic<size_t> split_debt_ {0}; // splits owed by writers; paid under mtx_split_
+    detail::MixedHash<Hash> hasher_;
+
+    // K is Key, or anything the transparent Hash and EqualTo accept
+    template <typename K>
+    static constexpr bool is_lookup_key = std::is_same_v<K, Key> || (detail::is_transparent<Hash>::value && detail::is_transparent<EqualTo>::value);
+
+    static size_t floor_log2(size_t n)
+    {
+        size_t log = 0;
+        while (n >>= 1)
+            ++log;
+        return log;
+    }
+
+    static size_t ceil_pow2(size_t n)
+    {
+        size_t pow2 = 1;
+        while (pow2 < n)
+            pow2 <<= 1;
+        return pow2;
+    }
+
+    static size_t default_stripe_count()
+    {
+        return ceil_pow2(std::max(1u, std::thread::hardware_concurrency()) * 4);
+    }
+
+    // base * 2^level <= bucket_count < base * 2^(level + 1)
+    size_t round_count(size_t bucket_count) const
+    {
+        return base_count_ << floor_log2(bucket_count / base_count_);
+    }
+
+    // buckets below bucket_count - round_count(bucket_count) are split already - their keys use the doubled modulus
+    size_t bucket_index(size_t hash, size_t bucket_count) const
+    {
+        const size_t round = round_count(bucket_count);
+        const size_t index = hash % (2 * round);
+
+        return (index < bucket_count) ? index : index - round;
+    }
+
+    std::pair<size_t, size_t> segment_of(size_t index) const
+    {
+        if (index < base_count_)
+            return {0, index};
+
+        const size_t segment = floor_log2(index / base_count_) + 1;
+        return {segment, index - (base_count_ << (segment - 1))};
+    }
+
+    Bucket& get_bucket(size_t index) const
+    {
+        const auto [segment, offset] = segment_of(index);
 
-        bucket_data data_;
-        mutable std::shared_mutex mutex_;
+        return segments_[segment].load(std::memory_order_acquire)[offset];
+    }
+
+    Stripe& get_stripe(size_t index) const
+    {
+        return stripes_[index & (stripe_count_ - 1)];
+    }
+
+    // bucket_index() keeps the hash modulo the stripe count (all the moduli are its multiples), so the stripe of a key
+    // is known without the bucket count; the low bits of the mixed hash fold in the high bits of mix_hash's product,
+    // which depend on all bits of the key - keys with a stride of the stripe count spread over all stripes
+    size_t stripe_of_hash(size_t hash) const
+    {
+        return hash & (stripe_count_ - 1);
+    }
 
-        bucket_iterator find_entry_for(const Key& key)
+    // locks the stripe of the hash's bucket; a split may move the key between reading the bucket count and taking
+    // the lock, so the choice is checked again under the lock (splits of the bucket hold the lock of its stripe)
+    template <typename Lock>
+    LockedBucket<Lock> lock_bucket(size_t hash) const
+    {
+        for (;;)
         {
-            return std::find_if(data_.begin(), data_.end(), [&key](const auto& item) { return EqualTo{}(item.first, key); });
+            const size_t index = bucket_index(hash, bucket_count_.load(std::memory_order_acquire));
+            Stripe& stripe = get_stripe(index);
+            assert(&stripe == &stripes_[stripe_of_hash(hash)]);
+            Lock lk{stripe.mutex};
+
+            if (bucket_index(hash, bucket_count_.load(std::memory_order_acquire)) == index)
+                return {get_bucket(index), stripe, std::move(lk)};
         }
+    }
 
-        bucket_const_iterator find_entry_for(const Key& key) const
+    // the caller holds an EpochDomain::Guard; a split moving the key elsewhere meanwhile is seen in the bucket count
+    template <typename K>
+    std::optional<Value> read_lock_free(const K& key, size_t hash) const
+    {
+        for (;;)
         {
-            return std::find_if(data_.begin(), data_.end(), [&key](const auto& item) { return EqualTo{}(item.first, key); });
+            const size_t index = bucket_index(hash, bucket_count_.load(std::memory_order_acquire));
+            std::optional<Value> found_value = get_bucket(index).find_lock_free(key, hash);
+
+            if (bucket_index(hash, bucket_count_.load(std::memory_order_acquire)) == index)
+                return found_value;
         }
+    }
 
-    public:
-        Value value_for(const Key& key, const Value& default_value) const
+    // seqlock read: the bucket is read without a lock, the result counts only if no writer has touched
+    // the stripe (and no split has moved the key) meanwhile; false if writers kept interfering
+    template <typename K>
+    bool try_optimistic_read(const K& key, size_t hash, const Value& default_value, Value& value) const
+    {
+        for (size_t attempt = 0; attempt < optimistic_read_attempts; ++attempt)
         {
-            std::shared_lock lk{mutex_};
+            const size_t index = bucket_index(hash, bucket_count_.load(std::memory_order_acquire));
+            const Stripe& stripe = get_stripe(index);
+
+            const uint64_t seq = stripe.seq.load(std::memory_order_acquire);
+            if (seq % 2 != 0)
+                continue;
 
-            bucket_const_iterator found_entry = find_entry_for(key);
+            if (!get_bucket(index).find_optimistic(key, hash, value))
+                value = default_value;
 
-            return (found_entry == data_.end()) ? default_value : found_entry->second;
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (stripe.seq.load(std::memory_order_relaxed) == seq
+                && bucket_index(hash, bucket_count_.load(std::memory_order_relaxed)) == index)
+                return true;
         }
 
-        void add_or_update_mapping(const Key& key, const Value& value)
+        return false;
+    }
+
+    // a writer that finds the table overloaded adds its splits to the debt; the one holding the split lock
+    // pays the debt of writers that found the lock taken, so the load factor stays bounded however many write
+    void grow(size_t splits = splits_per_insert)
+    {
+        split_debt_.fetch_add(splits);
+
+        do
+        {
+            std::unique_lock lk_split{mtx_split_, std::try_to_lock};
+            if (!lk_split.owns_lock()) // the writer holding it takes over the debt
+                return;
+
+            while (split_debt_.load() > 0)
+            {
+                if (load_factor() <= max_load_factor() || !split_next_bucket())
+                {
+                    split_debt_.store(0); // nothing left to split for
+                    break;
+                }
+
+                split_debt_.fetch_sub(1);
+            }
+        } while (split_debt_.load() > 0); // added after the last check by a writer that found the lock taken
+    }
+
+    bool split_next_bucket()
+    {
+        const size_t bucket_count = bucket_count_.load(std::memory_order_relaxed); // changed only under mtx_split_
+        const size_t round = round_count(bucket_count);
+
+        const auto [segment, offset] = segment_of(bucket_count);
+        if (offset == 0)
         {
-            std::unique_lock lk{mutex_};
+            if (segment == max_segments)
+                return false;
+
+            segments_[segment].store(new Bucket[bucket_count], std::memory_order_release); // as many as before it
+        }
+
+        Bucket& from = get_bucket(bucket_count - round);
+        Bucket& to = get_bucket(bucket_count);
 
-            const bucket_iterator found_entry = find_entry_for(key);
+        assert(&get_stripe(bucket_count - round) == &get_stripe(bucket_count));
+        std::unique_lock lk{get_stripe(bucket_count).mutex};
+        WriteSection write{get_stripe(bucket_count)};
 
-            if (found_entry == data_.end())
-                data_.push_back(bucket_value{key, value});
-            else
-                found_entry->second = value;
+        const auto moves = [&](const Key&, size_t hash) { return hash % (2 * round) == bucket_count; };
+
+        if constexpr (Bucket::lock_free_reads)
+        {
+            from.copy_if(to, moves, hasher_);
+            bucket_count_.store(bucket_count + 1, std::memory_order_release);
+            from.erase_if(moves, hasher_);
         }
+        else
+        {
+            from.move_if(to, moves, hasher_);
+            bucket_count_.store(bucket_count + 1, std::memory_order_release);
+        }
+
+        return true;
+    }
 
-        void remove_mapping(const Key& key)
+    // runs modify(bucket, hash) under the unique lock of the key's bucket; modify returns the change
+    // of the bucket's entry count (-1, 0 or 1)
+    template <typename K, typename Modify>
+    void modify_bucket(const K& key, Modify modify)
+    {
+        const size_t hash = hasher_(key);
+        size_t stripe_size = 0;
+        int added = 0;
         {
-            std::unique_lock lk{mutex_};
+            auto [bucket, stripe, lk] = lock_bucket<std::unique_lock<std::shared_mutex>>(hash);
+            WriteSection write{stripe};
 
-            const bucket_iterator found_entry = find_entry_for(key);
-            if (found_entry != data_.end())
-                data_.erase(found_entry);
+            added = modify(bucket, hash);
+            stripe_size = stripe.size.load(std::memory_order_relaxed) + static_cast<size_t>(added); // wraps for -1
+            stripe.size.store(stripe_size, std::memory_order_relaxed);
         }
+
+        // hashes spread evenly over stripes - the load of one stripe stands for the whole table
+        if (added > 0 && stripe_size * stripe_count_ > max_load_factor() * bucket_count())
+            grow();
+    }
+
+    // the bodies of the public overloads for key_type and for a transparent K
+
+    template <typename K, typename F>
+    bool visit_value(const K& key, F& f) const
+    {
+        const size_t hash = hasher_(key);
+        auto [bucket, stripe, lk] = lock_bucket<std::shared_lock<std::shared_mutex>>(hash);
+
+        const Value* value = bucket.find(key, hash);
+        if (value == nullptr)
+            return false;
+
+        f(*value);
+        return true;
+    }
+
+    template <typename K, typename F>
+    bool update_value(const K& key, F& f)
+    {
+        bool found = false;
+        modify_bucket(key, [&](Bucket& bucket, size_t hash) {
+            found = bucket.update(key, hash, f);
+            return 0;
+        });
+        return found;
+    }
+
+    template <typename K, typename... Args>
+    bool emplace_value(const K& key, Args&&... args)
+    {
+        bool inserted = false;
+        modify_bucket(key, [&](Bucket& bucket, size_t hash) {
+            inserted = bucket.try_emplace(key, hash, hasher_, std::forward<Args>(args)...);
+            return inserted ? 1 : 0;
+        });
+        return inserted;
+    }
+
+    template <typename K, typename V>
+    bool assign_value(const K& key, V&& value)
+    {
+        bool inserted = false;
+        modify_bucket(key, [&](Bucket& bucket, size_t hash) {
+            inserted = bucket.insert_or_assign(key, hash, std::forward<V>(value), hasher_);
+            return inserted ? 1 : 0;
+        });
+        return inserted;
+    }
+
+    template <typename K, typename F>
+    bool compute_value(const K& key, F& f)
+    {
+        bool present = false;
+        modify_bucket(key, [&](Bucket& bucket, size_t hash) {
+            const Value* current = bucket.find(key, hash);
+            std::optional<Value> result = f(current);
+
+            present = result.has_value();
+            if (present)
+                return bucket.insert_or_assign(key, hash, std::move(*result), hasher_) ? 1 : 0;
+
+            return (current != nullptr && bucket.erase(key, hash)) ? -1 : 0;
+        });
+        return present;
+    }
+
+    struct BatchEntry
+    {
+        size_t hash;
+        size_t position; // in the caller's range
     };
 
-    std::vector<std::unique_ptr<Bucket>> buckets_;
-    Hash hasher_;
+    using batch_iterator = typename std::vector<BatchEntry>::const_iterator;
+
+    // hashes the keys of a batch up front, starts loading their buckets and orders them by stripe;
+    // the buckets are located without a lock - only as a prefetch hint, a split may still move a key
+    template <typename Range, typename KeyOf>
+    std::vector<BatchEntry> prepare_batch(const Range& range, KeyOf key_of) const
+    {
+        std::vector<BatchEntry> batch(std::size(range));
+        const size_t bucket_count = bucket_count_.load(std::memory_order_acquire);
+
+        for (size_t i = 0; i < batch.size(); ++i)
+        {
+            const size_t hash = hasher_(key_of(range[i]));
+            batch[i] = BatchEntry{hash, i};
+            detail::prefetch(&get_bucket(bucket_index(hash, bucket_count)));
+        }
+
+        // by position within a stripe - of repeated keys the last one wins, as with single calls
+        std::sort(batch.begin(), batch.end(), [this](const BatchEntry& a, const BatchEntry& b) {
+            return std::make_pair(stripe_of_hash(a.hash), a.position) < std::make_pair(stripe_of_hash(b.hash), b.position);
+        });
 
-    Bucket& get_bucket(const Key& key) const
+        return batch;
+    }
+
+    // calls f(stripe, first, last) for each run of batch entries of one stripe
+    template <typename F>
+    void for_each_stripe(const std::vector<BatchEntry>& batch, F f) const
     {
-        auto const bucket_index = hasher_(key) % buckets_.size();
+        for (auto first = batch.begin(); first != batch.end();)
+        {
+            const size_t stripe = stripe_of_hash(first->hash);
+            const auto last = std::find_if(first, batch.end(), [&](const BatchEntry& entry) { return stripe_of_hash(entry.hash) != stripe; });
 
-        return *buckets_[bucket_index];
+            f(stripes_[stripe], first, last);
+            first = last;
+        }
+    }
+
+    // under the lock of the stripe its buckets are not split - they can be located once for a run of entries
+    void prefetch_buckets(batch_iterator first, batch_iterator last, size_t bucket_count) const
+    {
+        for (auto entry = first; entry != last; ++entry)
+            get_bucket(bucket_index(entry->hash, bucket_count)).prefetch(entry->hash);
     }
 
 public:
@@ -82,32 +451,264 @@ public:
     using value_type = Value;
     using hash_type = Hash;
     using equal_to_type = EqualTo;
+    using storage_type = Storage;
 
-    ThreadSafeLookupTable(unsigned int bucket_count = 19, const Hash& hasher = Hash{})
-        : buckets_(bucket_count), hasher_{hasher}
+    // bucket_count is rounded up to a multiple of the stripe count, stripe_count up to a power of 2
+    ThreadSafeLookupTable(unsigned int bucket_count = 19, const Hash& hasher = Hash{}, size_t stripe_count = default_stripe_count())
+        : stripe_count_{ceil_pow2(stripe_count)}
+        , base_count_{(std::max<size_t>(1, bucket_count) + stripe_count_ - 1) / stripe_count_ * stripe_count_}
+        , stripes_{std::make_unique<Stripe[]>(stripe_count_)}
+        , bucket_count_{base_count_}
+        , hasher_{hasher}
     {
-        for (unsigned int i = 0; i < bucket_count; ++i)
-        {
-            buckets_[i] = std::make_unique<Bucket>();
-        }
+        segments_[0].store(new Bucket[base_count_]);
     }
 
     ThreadSafeLookupTable(const ThreadSafeLookupTable&) = delete;
     ThreadSafeLookupTable& operator=(const ThreadSafeLookupTable&) = delete;
 
+    ~ThreadSafeLookupTable()
+    {
+        for (auto& segment : segments_)
+            delete[] segment.load();
+    }
+
     value_type value_for(const key_type& key, const value_type& default_value = value_type()) const
     {
-        return get_bucket(key).value_for(key, default_value);
+        return value_for<key_type>(key, default_value);
+    }
+
+    template <typename K, typename = std::enable_if_t<is_lookup_key<K>>>
+    value_type value_for(const K& key, const value_type& default_value = value_type()) const
+    {
+        const size_t hash = hasher_(key);
+
+        if constexpr (Bucket::lock_free_reads)
+        {
+            EpochDomain::Guard guard;
+            std::optional<Value> found_value = read_lock_free(key, hash);
+
+            return found_value ? std::move(*found_value) : default_value;
+        }
+
+        if constexpr (Bucket::optimistic_reads && std::is_same_v<K, Key>)
+        {
+            value_type value = default_value;
+            if (try_optimistic_read(key, hash, default_value, value))
+                return value;
+        }
+
+        auto [bucket, stripe, lk] = lock_bucket<std::shared_lock<std::shared_mutex>>(hash);
+
+        const Value* found_value = bucket.find(key, hash);
+
+        return (found_value == nullptr) ? default_value : *found_value;
     }
 
     void add_or_update_mapping(const key_type& key, const value_type& value)
     {
-        get_bucket(key).add_or_update_mapping(key, value);
+        assign_value(key, value);
+    }
+
+    template <typename K, typename = std::enable_if_t<is_lookup_key<K>>>
+    void add_or_update_mapping(const K& key, const value_type& value)
+    {
+        assign_value(key, value);
+    }
+
+    // moves the value in; returns true if the key was not there
+    bool insert_or_assign(const key_type& key, value_type&& value)
+    {
+        return assign_value(key, std::move(value));
+    }
+
+    template <typename K, typename = std::enable_if_t<is_lookup_key<K>>>
+    bool insert_or_assign(const K& key, value_type&& value)
+    {
+        return assign_value(key, std::move(value));
+    }
+
+    // constructs the value from args only if the key is absent; returns true if it was
+    template <typename... Args>
+    bool try_emplace(const key_type& key, Args&&... args)
+    {
+        return emplace_value(key, std::forward<Args>(args)...);
+    }
+
+    template <typename K, typename... Args, typename = std::enable_if_t<is_lookup_key<K>>>
+    bool try_emplace(const K& key, Args&&... args)
+    {
+        return emplace_value(key, std::forward<Args>(args)...);
+    }
+
+    // the callbacks below run under the lock of the key's stripe - they must be short and must not use the table
+
+    // f(const Value&) reads the value in place, under the shared lock; returns false if the key is absent
+    template <typename F>
+    bool visit(const key_type& key, F&& f) const
+    {
+        return visit_value(key, f);
+    }
+
+    template <typename K, typename F, typename = std::enable_if_t<is_lookup_key<K>>>
+    bool visit(const K& key, F&& f) const
+    {
+        return visit_value(key, f);
+    }
+
+    // f(Value&) modifies the value in place (EpochListStorage: a copy that replaces it); returns false if the key is absent
+    template <typename F>
+    bool update(const key_type& key, F&& f)
+    {
+        return update_value(key, f);
+    }
+
+    template <typename K, typename F, typename = std::enable_if_t<is_lookup_key<K>>>
+    bool update(const K& key, F&& f)
+    {
+        return update_value(key, f);
+    }
+
+    // atomic read-modify-write: f(const Value* current) gets nullptr if the key is absent and returns
+    // std::optional<Value> - the new value, or std::nullopt to remove the entry; returns true if the key has a value now
+    template <typename F>
+    bool compute(const key_type& key, F&& f)
+    {
+        return compute_value(key, f);
+    }
+
+    template <typename K, typename F, typename = std::enable_if_t<is_lookup_key<K>>>
+    bool compute(const K& key, F&& f)
+    {
+        return compute_value(key, f);
     }
 
     void remove_mapping(const key_type& key)
     {
-        get_bucket(key).remove_mapping(key);
+        remove_mapping<key_type>(key);
+    }
+
+    template <typename K, typename = std::enable_if_t<is_lookup_key<K>>>
+    void remove_mapping(const K& key)
+    {
+        modify_bucket(key, [&](Bucket& bucket, size_t hash) { return bucket.erase(key, hash) ? -1 : 0; });
+    }
+
+    // batched value_for(): keys is a random-access range of key_type (or of K with a transparent Hash and EqualTo),
+    // hashed up front and grouped by stripe - a stripe is locked once for all its keys; out[i] is set to the value
+    // for keys[i] or default_value; returns the number of keys found
+    template <typename Keys>
+    size_t multi_get(const Keys& keys, std::vector<value_type>& out, const value_type& default_value = value_type()) const
+    {
+        using K = std::decay_t<decltype(keys[0])>;
+        static_assert(is_lookup_key<K>, "keys of another type than key_type need a transparent Hash and EqualTo");
+
+        const std::vector<BatchEntry> batch = prepare_batch(keys, [](const K& key) -> const K& { return key; });
+        out.assign(batch.size(), default_value);
+        size_t found = 0;
+
+        if constexpr (Bucket::lock_free_reads) // no locks to amortize - one guard for the batch
+        {
+            EpochDomain::Guard guard;
+
+            for (const BatchEntry& entry : batch)
+            {
+                if (std::optional<Value> found_value = read_lock_free(keys[entry.position], entry.hash))
+                {
+                    out[entry.position] = std::move(*found_value);
+                    ++found;
+                }
+            }
+
+            return found;
+        }
+
+        for_each_stripe(batch, [&](Stripe& stripe, batch_iterator first, batch_iterator last) {
+            std::shared_lock lk{stripe.mutex};
+            const size_t bucket_count = bucket_count_.load(std::memory_order_acquire);
+            prefetch_buckets(first, last, bucket_count);
+
+            for (auto entry = first; entry != last; ++entry)
+            {
+                const Value* found_value = get_bucket(bucket_index(entry->hash, bucket_count)).find(keys[entry->position], entry->hash);
+                if (found_value != nullptr)
+                {
+                    out[entry->position] = *found_value;
+                    ++found;
+                }
+            }
+        });
+
+        return found;
+    }
+
+    // batched add_or_update_mapping(): pairs is a random-access range of pairs (first - the key, second - the value),
+    // grouped by stripe like the keys of multi_get(); of pairs with equal keys the last one wins
+    template <typename Pairs>
+    void multi_put(const Pairs& pairs)
+    {
+        using K = std::decay_t<decltype(pairs[0].first)>;
+        static_assert(is_lookup_key<K>, "keys of another type than key_type need a transparent Hash and EqualTo");
+
+        const std::vector<BatchEntry> batch = prepare_batch(pairs, [](const auto& pair) -> const K& { return pair.first; });
+        size_t added = 0;
+
+        for_each_stripe(batch, [&](Stripe& stripe, batch_iterator first, batch_iterator last) {
+            std::unique_lock lk{stripe.mutex};
+            WriteSection write{stripe};
+            const size_t bucket_count = bucket_count_.load(std::memory_order_acquire);
+            prefetch_buckets(first, last, bucket_count);
+
+            size_t stripe_added = 0;
+            for (auto entry = first; entry != last; ++entry)
+            {
+                const auto& pair = pairs[entry->position];
+                if (get_bucket(bucket_index(entry->hash, bucket_count)).insert_or_assign(pair.first, entry->hash, pair.second, hasher_))
+                    ++stripe_added;
+            }
+
+            stripe.size.store(stripe.size.load(std::memory_order_relaxed) + stripe_added, std::memory_order_relaxed);
+            added += stripe_added;
+        });
+
+        if (added > 0 && load_factor() > max_load_factor())
+            grow(splits_per_insert * added);
+    }
+
+    // the observers below are exact only while no writer runs
+
+    size_t size() const
+    {
+        size_t size = 0;
+        for (size_t i = 0; i < stripe_count_; ++i)
+            size += stripes_[i].size.load(std::memory_order_relaxed);
+        return size;
+    }
+
+    size_t bucket_count() const
+    {
+        return bucket_count_.load(std::memory_order_relaxed);
+    }
+
+    float load_factor() const
+    {
+        return static_cast<float>(size()) / static_cast<float>(bucket_count());
+    }
+
+    size_t stripe_count() const
+    {
+        return stripe_count_;
+    }
+
+    float max_load_factor() const
+    {
+        return max_load_factor_.load(std::memory_order_relaxed);
+    }
+
+    void max_load_factor(float max_load_factor)
+    {
+        assert(max_load_factor > 0.0f);
+        max_load_factor_.store(max_load_factor, std::memory_order_relaxed);
     }
 };
 